@@ -0,0 +1,105 @@
+// Times the lighting system's field of view from every walkable tile of each level, without a window or OpenGL
+// Usage: lighting_benchmark [level] [repetitions]
+
+// The rest of the game is linked in, so gl3w still needs its definitions even though it is never loaded
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// internal
+#include "lighting_system.hpp"
+#include "map_generator_system.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct LevelResult {
+	size_t origins = 0;
+	size_t visible_tiles = 0;
+	size_t triangles = 0;
+	double total_ns = 0;
+	double worst_ns = 0;
+};
+
+static LevelResult benchmark_level(const LightingSystem& lighting,
+								   const MapGeneratorSystem& map,
+								   int repetitions)
+{
+	LevelResult result;
+	for (uint y = 0; y < MapUtility::map_size * MapUtility::room_size; y++) {
+		for (uint x = 0; x < MapUtility::map_size * MapUtility::room_size; x++) {
+			uvec2 tile(x, y);
+			if (!map.walkable(tile)) {
+				continue;
+			}
+			for (int i = 0; i < repetitions; i++) {
+				auto start = Clock::now();
+				LightingSystem::FieldOfViewStats stats = lighting.compute_field_of_view(tile);
+				double ns = static_cast<double>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+				result.origins++;
+				result.visible_tiles += stats.visible_tiles;
+				result.triangles += stats.triangles;
+				result.total_ns += ns;
+				result.worst_ns = std::max(result.worst_ns, ns);
+			}
+		}
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	int only_level = (argc > 1) ? std::atoi(argv[1]) : -1;
+	int repetitions = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 5;
+
+	// Only the level layouts are needed, none of the systems the map would normally talk to
+	std::shared_ptr<MapGeneratorSystem> map
+		= std::make_shared<MapGeneratorSystem>(nullptr, nullptr, nullptr, nullptr, nullptr);
+	LightingSystem lighting(nullptr);
+	lighting.init(map);
+
+	printf("%-6s %8s %12s %12s %12s %12s\n", "level", "updates", "tiles", "triangles", "ns/update", "worst ns");
+	LevelResult total;
+	for (int level = 0; level < map->get_level_count(); level++) {
+		if (only_level != -1 && level != only_level) {
+			continue;
+		}
+		map->set_current_level(level);
+		LevelResult result = benchmark_level(lighting, *map, repetitions);
+		if (result.origins == 0) {
+			continue;
+		}
+		printf("%-6d %8zu %12zu %12zu %12.0f %12.0f\n",
+			   level,
+			   result.origins,
+			   result.visible_tiles,
+			   result.triangles,
+			   result.total_ns / static_cast<double>(result.origins),
+			   result.worst_ns);
+
+		total.origins += result.origins;
+		total.visible_tiles += result.visible_tiles;
+		total.triangles += result.triangles;
+		total.total_ns += result.total_ns;
+		total.worst_ns = std::max(total.worst_ns, result.worst_ns);
+	}
+
+	if (total.origins == 0) {
+		fprintf(stderr, "No walkable tiles found\n");
+		return EXIT_FAILURE;
+	}
+	printf("%-6s %8zu %12zu %12zu %12.0f %12.0f\n",
+		   "all",
+		   total.origins,
+		   total.visible_tiles,
+		   total.triangles,
+		   total.total_ns / static_cast<double>(total.origins),
+		   total.worst_ns);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+// Builds frames of the first level through the recording GL backend, so it runs without a display or GPU
+// Reports how long draw() takes on the CPU and what it would have sent to GL per frame
+// Usage: render_benchmark [extra enemies] [frames] [max draws per frame]
+// With a maximum, exits with a failure if any frame issues more draws than that
+
+// The rest of the game is linked in, so gl3w still needs its definitions even though it is never loaded
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// internal
+#include "lighting_system.hpp"
+#include "loot_system.hpp"
+#include "map_generator_system.hpp"
+#include "recording_gl_backend.hpp"
+#include "render_system.hpp"
+#include "turn_system.hpp"
+#include "tutorial_system.hpp"
+#include "world_init.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+using CallType = RecordingGLBackend::CallType;
+
+static constexpr std::array<const char*, static_cast<size_t>(CallType::Count)> call_type_names = {
+	"draws", "programs", "vertex arrays", "textures", "buffers", "framebuffers", "uniforms", "uploads", "state", "resources", "queries",
+};
+
+// Packs enemies onto the walkable tiles nearest the player, so they are all in view
+static void spawn_enemies(const MapGeneratorSystem& map, uvec2 player_pos, int count)
+{
+	TEXTURE_ASSET_ID texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
+	for (auto [entity, enemy, request] : registry.view<Enemy, RenderRequest>().each()) {
+		texture = request.used_texture;
+		break;
+	}
+	if (texture == TEXTURE_ASSET_ID::TEXTURE_COUNT) {
+		fprintf(stderr, "No enemy on the level to copy\n");
+		return;
+	}
+
+	std::vector<uvec2> tiles;
+	for (uint y = 0; y < MapUtility::map_size * MapUtility::room_size; y++) {
+		for (uint x = 0; x < MapUtility::map_size * MapUtility::room_size; x++) {
+			if (map.walkable(uvec2(x, y))) {
+				tiles.emplace_back(x, y);
+			}
+		}
+	}
+	std::sort(tiles.begin(), tiles.end(), [player_pos](uvec2 a, uvec2 b) {
+		return distance2(vec2(a), vec2(player_pos)) < distance2(vec2(b), vec2(player_pos));
+	});
+	tiles.resize(std::min(tiles.size(), static_cast<size_t>(count)));
+
+	for (int i = 0; i < count && !tiles.empty(); i++) {
+		Entity entity = registry.create();
+		registry.emplace<MapPosition>(entity, tiles.at(i % tiles.size()));
+		registry.emplace<RenderRequest>(
+			entity, texture, EFFECT_ASSET_ID::ENEMY, GEOMETRY_BUFFER_ID::SMALL_SPRITE, true);
+		registry.emplace<Animation>(entity);
+		registry.emplace<Stats>(entity);
+		registry.emplace<Enemy>(entity);
+		registry.emplace<Color>(entity, vec3(1));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int extra_enemies = (argc > 1) ? std::max(0, std::atoi(argv[1])) : 200;
+	int frames = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 100;
+	long max_draws = (argc > 3) ? std::atol(argv[3]) : -1;
+
+	RecordingGLBackend recorder;
+	Debug debugging;
+
+	// Only what loading a level and drawing it needs
+	std::shared_ptr<LootSystem> loot = std::make_shared<LootSystem>();
+	std::shared_ptr<TurnSystem> turns = std::make_shared<TurnSystem>();
+	std::shared_ptr<TutorialSystem> tutorials = std::make_shared<TutorialSystem>();
+	std::shared_ptr<MapGeneratorSystem> map
+		= std::make_shared<MapGeneratorSystem>(loot, turns, tutorials, nullptr, nullptr);
+	LightingSystem lighting(tutorials);
+	RenderSystem renderer(debugging, lighting);
+
+	Entity player = create_player(uvec2(0));
+	Entity camera = create_camera(uvec2(0));
+	map->load_initial_level();
+	uvec2 player_pos = registry.get<MapPosition>(player).position;
+	registry.get<WorldPosition>(camera).position = MapUtility::map_position_to_world_position(player_pos);
+
+	renderer.init(window_width_px, window_height_px, nullptr, map, &recorder);
+	lighting.init(map);
+	spawn_enemies(*map, player_pos, extra_enemies);
+	lighting.step(0);
+
+	std::array<size_t, static_cast<size_t>(CallType::Count)> totals = {};
+	size_t worst_draws = 0;
+	double total_ns = 0;
+	RenderSystem::FrameStats stats_total;
+	for (int frame = 0; frame < frames; frame++) {
+		recorder.clear();
+		auto start = Clock::now();
+		renderer.draw();
+		total_ns += static_cast<double>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+
+		for (size_t type = 0; type < totals.size(); type++) {
+			totals.at(type) += recorder.count(static_cast<CallType>(type));
+		}
+		worst_draws = std::max(worst_draws, recorder.count(CallType::Draw));
+		const RenderSystem::FrameStats& stats = renderer.get_frame_stats();
+		stats_total.commands += stats.commands;
+		stats_total.redundant_binds += stats.redundant_binds;
+		stats_total.in_view += stats.in_view;
+		stats_total.culled += stats.culled;
+	}
+
+	printf("%zu enemies, %d frames, %.0f ns/frame\n", registry.view<Enemy>().size(), frames, total_ns / frames);
+	printf("GL calls per frame:\n");
+	for (size_t type = 0; type < totals.size(); type++) {
+		printf("  %-14s %10.1f\n", call_type_names.at(type), static_cast<double>(totals.at(type)) / frames);
+	}
+	printf("  %-14s %10.1f\n", "commands", static_cast<double>(stats_total.commands) / frames);
+	printf("  %-14s %10.1f\n", "skipped binds", static_cast<double>(stats_total.redundant_binds) / frames);
+	printf("  %-14s %10.1f\n", "in view", static_cast<double>(stats_total.in_view) / frames);
+	printf("  %-14s %10.1f\n", "culled", static_cast<double>(stats_total.culled) / frames);
+
+	if (max_draws >= 0 && worst_draws > static_cast<size_t>(max_draws)) {
+		fprintf(stderr, "A frame issued %zu draws, more than the allowed %ld\n", worst_draws, max_draws);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
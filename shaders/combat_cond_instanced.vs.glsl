@@ -0,0 +1,30 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per instance attributes
+in mat3 in_transform;
+// Current frame and condition of the instance
+in vec4 in_frame;
+
+// Passed to fragment shader
+out vec2 texcoord;
+
+// Application data
+uniform mat3 projection;
+
+// Value used for representing number of frames:
+uniform float num_frames = 8;
+// Value denoting total number of states for an enemy:
+uniform float num_states = 8;
+
+void main()
+{
+	texcoord = in_texcoord;
+	texcoord.x += (1/num_frames * in_frame.x);
+	texcoord.y += (1/num_states * in_frame.y);
+	vec3 pos = projection * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
@@ -0,0 +1,34 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec3 in_color;
+
+// Per instance attributes
+in mat3 in_transform;
+in vec4 in_instance_color;
+// Fill of the bar in x, ratio of its width to its height in y
+in vec4 in_frame;
+
+out vec2 out_local_pos;
+out vec3 vcolor;
+out vec3 pos;
+flat out vec3 fcolor;
+flat out float xy_ratio;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	vcolor = in_color;
+	fcolor = in_instance_color.rgb;
+	xy_ratio = in_frame.y;
+	vec2 local_position = in_position.xy;
+	if(in_color != vec3(0, 0, 0)) {
+		local_position *= vec2(in_frame.x, 1.0);
+	}
+	out_local_pos = local_position - vec2(.5, 0);
+	pos = projection * in_transform * vec3(local_position, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec3 in_color;
+
+// Per instance attributes
+in mat3 in_transform;
+// Fill of the bar in x
+in vec4 in_frame;
+
+out vec3 vcolor;
+out vec3 pos;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	vcolor = in_color;
+	vec2 local_position = in_position.xy;
+	if(in_color != vec3(0, 0, 0)) {
+		local_position *= vec2(in_frame.x, 1.0);
+	}
+	pos = projection * in_transform * vec3(local_position, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+flat in vec2 world_pos;
+flat in vec4 room_state;
+
+// Application data
+uniform sampler2D sampler0;
+
+// Output color
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	// Rooms that aren't appearing have an unbounded reveal distance
+	if (distance(room_state.xy, world_pos) > room_state.z) {
+		discard;
+	}
+	color = texture(sampler0, texcoord);
+}
@@ -0,0 +1,55 @@
+#version 330
+
+// Draws a rectangle of the level's tiles without any vertex data, six vertices per tile
+
+// Passed to fragment shader
+out vec2 texcoord;
+flat out vec2 world_pos;
+flat out vec4 room_state;
+
+// Application data
+uniform mat3 projection;
+// Tile ids of the whole level, one texel per tile
+uniform usampler2D tile_ids;
+// Per room reveal state, xy: reveal start, z: reveal distance, w: 1 if the room is shown
+uniform sampler2D room_states;
+
+uniform ivec2 tile_origin;
+uniform int tile_columns;
+uniform vec2 map_top_left;
+uniform float tile_size;
+
+const int room_size = 10;
+
+void main()
+{
+	// Corners of a tile, in the same order as the per room tilemap
+	const vec2 corners[] = vec2[](
+		vec2(0.0, 0.0),
+		vec2(0.0, 1.0),
+		vec2(1.0, 0.0),
+		vec2(1.0, 0.0),
+		vec2(0.0, 1.0),
+		vec2(1.0, 1.0)
+	);
+
+	int vertex_id = gl_VertexID % 6;
+	int tile_index = gl_VertexID / 6;
+	ivec2 tile = tile_origin + ivec2(tile_index % tile_columns, tile_index / tile_columns);
+
+	room_state = texelFetch(room_states, tile / room_size, 0);
+	if (room_state.w == 0.0) {
+		// Collapse the tile so nothing gets rasterized for hidden rooms
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		texcoord = vec2(0);
+		world_pos = vec2(0);
+		return;
+	}
+
+	uint texture_id = texelFetch(tile_ids, tile, 0).r;
+	texcoord = (corners[vertex_id] + vec2(int(texture_id) % 8, int(texture_id) / 8)) * 32.0 / 256.0;
+
+	world_pos = map_top_left + vec2(tile) * tile_size;
+	vec3 pos = projection * vec3(world_pos + corners[vertex_id] * tile_size, 1.0);
+	gl_Position = vec4(pos, 1.0);
+}
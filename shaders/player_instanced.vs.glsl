@@ -0,0 +1,33 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per instance attributes
+in mat3 in_transform;
+in vec4 in_instance_color;
+// Current frame and state of the instance
+in vec4 in_frame;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 instance_color;
+
+// Application data
+uniform mat3 projection;
+
+// Value used for representing number of frames:
+uniform float num_frames = 8;
+// Value denoting total number of states for an enemy:
+uniform float num_states = 8;
+
+void main()
+{
+	texcoord = in_texcoord;
+	texcoord.x += (1/num_frames * in_frame.x);
+	texcoord.y += (1/num_states * in_frame.y);
+	instance_color = in_instance_color.rgb;
+	vec3 pos = projection * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
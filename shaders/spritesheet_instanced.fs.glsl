@@ -0,0 +1,19 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+in vec3 instance_color;
+in vec4 sprite_rect;
+
+// Application data
+uniform sampler2D sampler0;
+
+// Output color
+layout(location = 0) out  vec4 color;
+
+void main()
+{
+	ivec2 full_size = textureSize(sampler0, 0);
+	vec2 texcoord_shifted = (texcoord * sprite_rect.zw + sprite_rect.xy) / vec2(full_size);
+	color = vec4(instance_color, 1.0) * texture(sampler0, texcoord_shifted);
+}
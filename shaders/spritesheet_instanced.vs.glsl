@@ -0,0 +1,28 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per instance attributes
+in mat3 in_transform;
+in vec4 in_instance_color;
+// Offset into the spritesheet in xy, size of the sprite in zw, both in pixels
+in vec4 in_frame;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 instance_color;
+out vec4 sprite_rect;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	texcoord = in_texcoord;
+	instance_color = in_instance_color.rgb;
+	sprite_rect = in_frame;
+	vec3 pos = projection * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
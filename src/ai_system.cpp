@@ -10,7 +10,8 @@ AISystem::AISystem(const Debug& debugging,
 				   LightingSystem& lighting,
 				   std::shared_ptr<MapGeneratorSystem> map_generator,
 				   std::shared_ptr<TurnSystem> turns,
-				   std::shared_ptr<SoLoud::Soloud> so_loud)
+				   std::shared_ptr<SoLoud::Soloud> so_loud,
+				   const RandomStreams& random)
 	: debugging(debugging)
 	, animations(std::move(animations))
 	, combat(std::move(combat))
@@ -19,7 +20,7 @@ AISystem::AISystem(const Debug& debugging,
 	, turns(std::move(turns))
 	, so_loud(std::move(so_loud))
 	, enemy_team(registry.create())
-	, rng(std::random_device()())
+	, rng(random.get(RandomStreams::Stream::AI))
 	, uniform_dist(0.00f, 1.00f)
 {
 	registry.emplace<DebugComponent>(enemy_team);
@@ -448,7 +449,7 @@ bool AISystem::is_player_spotted(const Entity& entity)
 	uvec2 player_map_pos = registry.get<MapPosition>(registry.view<Player>().front()).position;
 	uvec2 entity_map_pos = registry.get<MapPosition>(entity).position;
 
-	if (!lighting.is_visible(entity_map_pos)) {
+	if (!lighting.is_visible_from(player_map_pos, entity_map_pos)) {
 		return false;
 	}
 
@@ -557,7 +558,7 @@ bool AISystem::is_health_below(const Entity& entity, float ratio)
 
 bool AISystem::chance_to_happen(float percent)
 {
-	float chance = uniform_dist(rng);
+	float chance = uniform_dist(*rng);
 	bool result = chance < percent;
 	return result;
 }
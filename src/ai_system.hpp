@@ -9,6 +9,7 @@
 #include "combat_system.hpp"
 #include "lighting_system.hpp"
 #include "map_generator_system.hpp"
+#include "random_streams.hpp"
 #include "turn_system.hpp"
 #include "world_init.hpp"
 
@@ -26,7 +27,8 @@ public:
 			 LightingSystem& lighting,
 			 std::shared_ptr<MapGeneratorSystem> map_generator,
 			 std::shared_ptr<TurnSystem> turns,
-			 std::shared_ptr<SoLoud::Soloud> so_loud);
+			 std::shared_ptr<SoLoud::Soloud> so_loud,
+			 const RandomStreams& random);
 
 	void step(float elapsed_ms);
 
@@ -117,8 +119,8 @@ private:
 	// Entity representing the enemy team's turn.
 	Entity enemy_team;
 
-	// C++ random number generator
-	std::default_random_engine rng;
+	// C++ random number generator, the AI's stream of the game's random streams
+	std::shared_ptr<std::default_random_engine> rng;
 	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 
 
@@ -409,8 +411,8 @@ private:
 
 				for (int i = 0; i < num_attacks; i++) {
 					ivec2 attack_i;
-					attack_i.x = dist(ai->rng);
-					attack_i.y = dist(ai->rng);
+					attack_i.x = dist(*ai->rng);
+					attack_i.y = dist(*ai->rng);
 
 					// Check if point is more than 3 tiles from other points and the dragon
 					bool too_close = false;
@@ -1,5 +1,8 @@
 #include "animation_system.hpp"
 
+// stlib
+#include <algorithm>
+
 /// static helpers
 static void move_camera_to(const vec2& dest)
 {
@@ -52,6 +55,9 @@ void AnimationSystem::update_animations(float elapsed_ms, ColorState inactive_co
 	resolve_transient_event_animations();
 	resolve_undisplay_event_animations();
 	resolve_travel_event_animations(elapsed_ms);
+	if (turbo) {
+		complete_event_animations();
+	}
 }
 
 void AnimationSystem::set_sprite_direction(const Entity& sprite, Sprite_Direction direction)
@@ -519,6 +525,18 @@ void AnimationSystem::trigger_aoe_attack_animation(const Entity& aoe, int aoe_st
 
 bool AnimationSystem::animation_events_completed() { return (registry.empty<EventAnimation, TransientEventAnimation, TravelEventAnimation>()); }
 
+bool AnimationSystem::is_idle()
+{
+	if (!animation_events_completed() || !registry.empty<UndisplayEventAnimation, RoomAnimation>()) {
+		return false;
+	}
+	// Rooms and the player's arrow have a Velocity too, but only projectiles in flight move
+	auto projectiles = registry.view<ActiveProjectile, Velocity>();
+	return std::none_of(projectiles.begin(), projectiles.end(), [&](Entity entity) {
+		return projectiles.get<Velocity>(entity).speed != 0;
+	});
+}
+
 void AnimationSystem::resolve_event_animations()
 {
 	for (auto [entity, event_animation, actual_animation] : registry.view<EventAnimation, Animation>().each()) {
@@ -618,6 +636,34 @@ void AnimationSystem::resolve_travel_event_animations(float elapsed_ms)
 	}
 }
 
+void AnimationSystem::complete_event_animations()
+{
+	for (auto [entity, event_animation, actual_animation] : registry.view<EventAnimation, Animation>().each()) {
+		actual_animation.speed_adjustment = event_animation.restore_speed;
+		actual_animation.state = event_animation.restore_state;
+		actual_animation.display_color = event_animation.restore_color;
+		registry.remove<EventAnimation>(entity);
+	}
+
+	auto transient_view = registry.view<TransientEventAnimation>();
+	registry.destroy(transient_view.begin(), transient_view.end());
+
+	for (auto [entity, event_animation, effect] : registry.view<UndisplayEventAnimation, EffectRenderRequest>().each()) {
+		effect.visible = false;
+	}
+	for (auto [entity, event_animation, render] : registry.view<UndisplayEventAnimation, RenderRequest>().each()) {
+		render.visible = false;
+	}
+	registry.clear<UndisplayEventAnimation>();
+
+	// Travellers land on their map position, which they never left
+	for (auto [entity, travel_animation, actual_animation] : registry.view<TravelEventAnimation, Animation>().each()) {
+		actual_animation.state = travel_animation.restore_state;
+		actual_animation.speed_adjustment = travel_animation.restore_speed;
+		registry.remove<TravelEventAnimation, WorldPosition>(entity);
+	}
+}
+
 void AnimationSystem::animation_event_setup(Animation& animation, EventAnimation& EventAnimation, vec4& color) 
 {
 	// Stores restoration states for the player's animations, to be called after animation event is resolved
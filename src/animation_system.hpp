@@ -156,6 +156,13 @@ public:
 	// or damage calculations have been completed
 	bool animation_events_completed();
 
+	// True when nothing on screen is moving apart from looping sprite animations, e.g. waiting on the player's turn
+	bool is_idle();
+
+	// In turbo mode every event animation finishes on the update after it starts, so turns never wait on them
+	// Meant for headless and bot games, where nobody is watching
+	void set_turbo(bool enabled) { turbo = enabled; }
+
 
 
 
@@ -173,6 +180,8 @@ private:
 	// and travel abunation component from associated entity, otherwise updates time, as well as map position of entity
 	// based on time update and spline equation
 	void resolve_travel_event_animations(float elapsed_ms);
+	// helper function, finishes every outstanding event animation at once as if it had played out, used in turbo mode
+	void complete_event_animations();
 	// helper function for setting animation events
 	void animation_event_setup(Animation& animation, EventAnimation& EventAnimation, vec4& color);
 	// Copies over animations from original to copy
@@ -184,6 +193,7 @@ private:
 	void camera_track_buffer();
 
 	RenderSystem* renderer;
+	bool turbo = false;
 };
 
 
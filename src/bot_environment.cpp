@@ -0,0 +1,163 @@
+#include "bot_environment.hpp"
+
+// stlib
+#include <algorithm>
+#include <cassert>
+
+namespace {
+BotObservation::Tile classify_tile(const MapGeneratorSystem& map, uvec2 position)
+{
+	using Tile = BotObservation::Tile;
+	if (!map.is_on_map(position)) {
+		return Tile::Void;
+	}
+	// The player only knows the rooms they have revealed
+	Entity room = map.get_room_entity(MapUtility::get_room_index(position));
+	if (room == entt::null || !registry.get<Room>(room).visible) {
+		return Tile::Void;
+	}
+	MapUtility::TileID tile_id = map.get_tile_id_from_map_pos(position);
+	// Level exits are drawn as walls, so they're checked first
+	if (MapUtility::is_next_level_tile(tile_id)) {
+		return Tile::NextLevel;
+	}
+	if (MapUtility::is_last_level_tile(tile_id)) {
+		return Tile::LastLevel;
+	}
+	if (MapUtility::is_door_tile(tile_id)) {
+		return Tile::Door;
+	}
+	if (MapUtility::is_any_chest_tile(tile_id)) {
+		return Tile::Chest;
+	}
+	if (MapUtility::is_trap_tile(tile_id)) {
+		return Tile::Trap;
+	}
+	if (MapUtility::is_wall_tile(tile_id)) {
+		return Tile::Wall;
+	}
+	return MapUtility::is_walkable_tile(tile_id) ? Tile::Floor : Tile::Void;
+}
+} // namespace
+
+BotEnvironment::BotEnvironment(size_t lighting_workers)
+	: lighting_workers(lighting_workers)
+{
+}
+
+BotObservation BotEnvironment::reset(uint64_t seed)
+{
+	if (game == nullptr) {
+		game = std::make_unique<HeadlessGame>(seed, lighting_workers);
+		game->set_turbo(true);
+	} else {
+		game->restart(seed);
+	}
+	bool truncated = false;
+	advance(truncated);
+	return observe();
+}
+
+BotObservation BotEnvironment::observe() const
+{
+	assert(has_game());
+	const WorldSystem& world = game->get_world();
+	const MapGeneratorSystem& map = game->get_map();
+	const LightingSystem& lighting = game->get_lighting();
+	Entity player = registry.view<Player>().front();
+
+	BotObservation observation;
+	observation.position = registry.get<MapPosition>(player).position;
+	observation.level = map.get_current_level();
+	const Stats& stats = registry.get<Stats>(player);
+	observation.health = stats.health;
+	observation.health_max = stats.health_max;
+	observation.mana = stats.mana;
+	observation.mana_max = stats.mana_max;
+	// The player sees the colour they're not in as the inactive one
+	observation.active_color = (registry.get<PlayerInactivePerception>(player).inactive == ColorState::Red)
+		? ColorState::Blue
+		: ColorState::Red;
+	observation.resources = registry.get<Inventory>(player).resources;
+	observation.attack_count = game->get_ui().get_attack_count();
+	observation.awaiting_player = world.awaiting_player();
+	observation.finished = world.is_game_finished();
+
+	ivec2 centre = ivec2(observation.position);
+	int radius = static_cast<int>(BotObservation::view_radius);
+	for (int y = -radius; y <= radius; y++) {
+		for (int x = -radius; x <= radius; x++) {
+			ivec2 tile = centre + ivec2(x, y);
+			size_t index = static_cast<size_t>((y + radius) * static_cast<int>(BotObservation::view_size) + x + radius);
+			observation.tiles.at(index) = (tile.x < 0 || tile.y < 0) ? BotObservation::Tile::Void
+																		: classify_tile(map, uvec2(tile));
+		}
+	}
+
+	// Everything in sight, sorted nearest first before the furthest are dropped
+	std::vector<BotObservation::VisibleEntity> visible;
+	auto add_visible = [&](BotObservation::VisibleEntity entity, uvec2 position) {
+		if (!lighting.is_visible(position)) {
+			return;
+		}
+		entity.offset = ivec2(position) - centre;
+		if (std::max(abs(entity.offset.x), abs(entity.offset.y)) <= radius) {
+			visible.push_back(entity);
+		}
+	};
+	for (auto [entity, enemy, enemy_stats, map_position] : registry.view<Enemy, Stats, MapPosition>().each()) {
+		add_visible({ BotObservation::VisibleEntity::Kind::Enemy,
+					  static_cast<uint8_t>(enemy.type),
+					  enemy.team,
+					  { 0, 0 },
+					  enemy_stats.health,
+					  enemy_stats.health_max },
+					map_position.position);
+	}
+	for (auto [entity, item, map_position] : registry.view<Item, MapPosition>().each()) {
+		add_visible({ BotObservation::VisibleEntity::Kind::Item }, map_position.position);
+	}
+	for (auto [entity, pickup, map_position] : registry.view<ResourcePickup, MapPosition>().each()) {
+		add_visible({ BotObservation::VisibleEntity::Kind::Resource, static_cast<uint8_t>(pickup.resource) },
+					map_position.position);
+	}
+	std::stable_sort(visible.begin(),
+					 visible.end(),
+					 [](const BotObservation::VisibleEntity& a, const BotObservation::VisibleEntity& b) {
+						 return std::max(abs(a.offset.x), abs(a.offset.y)) < std::max(abs(b.offset.x), abs(b.offset.y));
+					 });
+	observation.entity_count = std::min(visible.size(), BotObservation::max_entities);
+	std::copy_n(visible.begin(), observation.entity_count, observation.entities.begin());
+	return observation;
+}
+
+BotStepResult BotEnvironment::step(const PlayerAction& action)
+{
+	assert(has_game());
+	WorldSystem& world = game->get_world();
+	BotStepResult result;
+	result.action_rejected = !world.perform_action(action);
+	result.ticks = advance(result.truncated);
+	result.observation = observe();
+	result.done = world.is_game_finished();
+	if (result.done) {
+		result.reward = (result.observation.health > 0) ? 1.f : -1.f;
+	}
+	return result;
+}
+
+size_t BotEnvironment::advance(bool& truncated)
+{
+	WorldSystem& world = game->get_world();
+	size_t ticks = 0;
+	do {
+		// Any key moves a conversation along once its text has finished appearing
+		if (world.in_cutscene()) {
+			world.send_input({ 0, InputEvent::Type::Key, GLFW_KEY_ENTER, GLFW_PRESS });
+		}
+		game->tick();
+		ticks++;
+	} while (!world.awaiting_player() && !world.is_game_finished() && ticks < max_ticks_per_step);
+	truncated = ticks >= max_ticks_per_step && !world.awaiting_player() && !world.is_game_finished();
+	return ticks;
+}
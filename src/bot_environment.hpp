@@ -0,0 +1,101 @@
+#pragma once
+
+#include "headless_game.hpp"
+
+// stlib
+#include <array>
+#include <memory>
+
+// Compact, fixed size snapshot of what the player knows, laid out as flat arrays that copy straight into tensors
+// Like the screen, it only shows the rooms the player has revealed and the entities in their line of sight
+struct BotObservation {
+	// The tile grid is a square centred on the player
+	static constexpr uint view_radius = 7;
+	static constexpr uint view_size = view_radius * 2 + 1;
+	// Enemies and pickups within the tile grid and in sight, nearest first, the furthest are dropped past this many
+	static constexpr size_t max_entities = 32;
+
+	enum class Tile : uint8_t {
+		Void = 0,
+		Floor = Void + 1,
+		Wall = Floor + 1,
+		Door = Wall + 1,
+		Chest = Door + 1,
+		Trap = Chest + 1,
+		NextLevel = Trap + 1,
+		LastLevel = NextLevel + 1,
+		Count = LastLevel + 1,
+	};
+
+	struct VisibleEntity {
+		enum class Kind : uint8_t { Enemy, Item, Resource, Count };
+		Kind kind = Kind::Enemy;
+		// EnemyType for enemies, Resource for resources, 0 for items
+		uint8_t type = 0;
+		ColorState team = ColorState::None;
+		// Tiles from the player, so the entity stands on position + offset
+		ivec2 offset = { 0, 0 };
+		int health = 0;
+		int health_max = 0;
+	};
+
+	// Row-major, offset (0, 0) is at index view_radius * view_size + view_radius
+	// Tiles off the map and in rooms not yet revealed are Void
+	std::array<Tile, view_size * view_size> tiles = {};
+	std::array<VisibleEntity, max_entities> entities = {};
+	size_t entity_count = 0;
+
+	uvec2 position = { 0, 0 };
+	int level = 0;
+	int health = 0;
+	int health_max = 0;
+	int mana = 0;
+	int mana_max = 0;
+	ColorState active_color = ColorState::Red;
+	std::array<size_t, (size_t)Resource::Count> resources = {};
+	// Attacks PlayerAction::attack can choose from
+	size_t attack_count = 0;
+
+	bool awaiting_player = false;
+	bool finished = false;
+};
+
+struct BotStepResult {
+	BotObservation observation;
+	// 1 for winning, -1 for dying, 0 otherwise
+	float reward = 0;
+	// The game ended
+	bool done = false;
+	// The game stopped waiting on the player for longer than a step is allowed to run
+	bool truncated = false;
+	// The action was rejected, e.g. walking into a wall, and the turn is still the player's
+	bool action_rejected = false;
+	size_t ticks = 0;
+};
+
+// A headless game in turbo mode behind a reset / observe / step interface for automated players
+// Each step applies one action and runs the game until it is the player's turn again, clicking through any cutscenes
+// Like HeadlessGame, it must be reset, stepped and destroyed on one thread
+class BotEnvironment {
+public:
+	explicit BotEnvironment(size_t lighting_workers = ThreadPool::hardware_workers);
+
+	// Starts a new game from the seed, must be called before anything else
+	BotObservation reset(uint64_t seed);
+	// Whether reset has been called, which observe and step need
+	bool has_game() const { return game != nullptr; }
+	BotObservation observe() const;
+	BotStepResult step(const PlayerAction& action);
+
+	const HeadlessGame& get_game() const { return *game; }
+
+private:
+	// Ticks until the player can act or the game ends, always at least once, returns the ticks run
+	size_t advance(bool& truncated);
+
+	// A step gives up waiting on the player after a minute of game time
+	static constexpr size_t max_ticks_per_step = 60 * 60;
+
+	size_t lighting_workers;
+	std::unique_ptr<HeadlessGame> game;
+};
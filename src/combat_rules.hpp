@@ -0,0 +1,53 @@
+#pragma once
+
+#include "components.hpp"
+
+// stlib
+#include <random>
+
+// The dice and arithmetic of combat, kept free of the registry so that CombatSystem and offline balance tools resolve
+// attacks the same way. Callers look up the conditions involved and apply the results to whatever holds their state.
+// The rolls draw from the engine in the same order as the game always has, so seeded games play out unchanged.
+namespace CombatRules {
+
+// Rolls to hit between the attack's min and max (inclusive) and adds the attacker's bonus for the attack's kind,
+// less the attacker's Disarm. It hits if that reaches the target's evasion, less the target's Entangle.
+template <typename Engine>
+bool roll_hit(const Attack& attack, const Stats& attacker, int disarm, const Stats& target, int entangle, Engine& rng)
+{
+	std::uniform_int_distribution<int> attack_roller(attack.to_hit_min, attack.to_hit_max);
+	int hit_bonus = (attack.mana_cost != 0) ? attacker.to_hit_spells : attacker.to_hit_weapons;
+	int attack_roll = attack_roller(rng) + hit_bonus - disarm;
+	return attack_roll >= target.evasion - entangle;
+}
+
+// Rolls damage between the attack's min and max (inclusive), adds the attacker's bonus and the target's modifier for
+// the attack's damage type, less the attacker's Weaken. Never negative.
+template <typename Engine>
+int roll_damage(const Attack& attack, const Stats& attacker, int weaken, const Stats& target, Engine& rng)
+{
+	std::uniform_int_distribution<int> damage_roller(attack.damage_min, attack.damage_max);
+	auto type = static_cast<size_t>(attack.damage_type);
+	return std::max(damage_roller(rng) + attacker.damage_bonus.at(type) - weaken + target.damage_modifiers.at(type), 0);
+}
+
+// Whether an effect with the given chance triggers on a hit
+template <typename Engine> bool roll_effect(float chance, Engine& rng)
+{
+	return std::uniform_real_distribution<float>(0, 1)(rng) <= chance;
+}
+
+// Extra damage a Crit of the given magnitude adds to a hit
+inline int crit_damage(int damage, int magnitude) { return damage * (magnitude - 1); }
+
+// Conditions don't stack, a new one only extends an existing one if it's stronger
+inline int stack_condition(int current, int magnitude) { return std::max(magnitude, current); }
+
+// Damage from a turn of Bleed or Burn with the given amount remaining, after the target's modifier. Never negative.
+inline int condition_damage(Effect effect, int amount, const Stats& target)
+{
+	DamageType type = (effect == Effect::Bleed) ? DamageType::Physical : DamageType::Fire;
+	return std::max(amount + target.damage_modifiers.at(static_cast<size_t>(type)), 0);
+}
+
+} // namespace CombatRules
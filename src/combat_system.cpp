@@ -1,14 +1,16 @@
 #include "combat_system.hpp"
 
+#include "combat_rules.hpp"
+
 #include <sstream>
 
-void CombatSystem::init(std::shared_ptr<std::default_random_engine> global_rng,
+void CombatSystem::init(std::shared_ptr<std::default_random_engine> random_stream,
 						std::shared_ptr<AnimationSystem> animation_system,
 						std::shared_ptr<LootSystem> loot_system,
 						std::shared_ptr<MapGeneratorSystem> map_generator_system,
 						std::shared_ptr<TutorialSystem> tutorial_system)
 {
-	this->rng = std::move(global_rng);
+	this->rng = std::move(random_stream);
 	this->animations = std::move(animation_system);
 	this->loot = std::move(loot_system);
 	this->map = std::move(map_generator_system);
@@ -56,9 +58,8 @@ void CombatSystem::apply_decrement_per_turn_effects(Entity entity)
 		switch (effect) {
 		case Effect::Bleed:
 		case Effect::Burn: {
-			DamageType type = (effect == Effect::Bleed) ? DamageType::Physical : DamageType::Fire;
 			Stats& stats = registry.get<Stats>(entity);
-			stats.health -= max(amount + stats.damage_modifiers[static_cast<int>(type)], 0);
+			stats.health -= CombatRules::condition_damage(effect, amount, stats);
 			break;
 		}
 		default:
@@ -176,21 +177,14 @@ bool CombatSystem::do_attack(Entity attacker_entity, Attack& attack, Entity targ
 
 	Stats& attacker = registry.get<Stats>(attacker_entity);
 	Stats& target = registry.get<Stats>(target_entity);
-	// Roll a random to hit between min and max (inclusive), add attacker's to_hit_bonus and subtract disarmed amount
-	std::uniform_int_distribution<int> attack_roller(attack.to_hit_min, attack.to_hit_max);
-	int hit_bonus = (attack.mana_cost != 0) ? attacker.to_hit_spells : attacker.to_hit_weapons;
-	int attack_roll = attack_roller(*rng) + hit_bonus - get_effect(attacker_entity, Effect::Disarm);
-
-	// It hits if the attack roll is >= the target's evasion minus entangled amount
-	bool success = attack_roll >= target.evasion - get_effect(target_entity, Effect::Entangle);
+	bool success = CombatRules::roll_hit(attack,
+										 attacker,
+										 get_effect(attacker_entity, Effect::Disarm),
+										 target,
+										 get_effect(target_entity, Effect::Entangle),
+										 *rng);
 	if (success) {
-		// Roll a random damage between min and max (inclusive), then
-		// add attacker's damage_bonus and the target's damage_modifiers, take away weakened amount
-		std::uniform_int_distribution<int> damage_roller(attack.damage_min, attack.damage_max);
-		size_t type = static_cast<size_t>(attack.damage_type);
-		int dmg = max(damage_roller(*rng) + attacker.damage_bonus.at(type) - get_effect(attacker_entity, Effect::Weaken)
-						  + target.damage_modifiers[type],
-					  0);
+		int dmg = CombatRules::roll_damage(attack, attacker, get_effect(attacker_entity, Effect::Weaken), target, *rng);
 		target.health -= dmg;
 		do_attack_effects(attacker_entity, attack, target_entity, dmg);
 	}
@@ -279,26 +273,26 @@ std::string CombatSystem::make_attack_list(const Entity entity, size_t current_a
 
 void CombatSystem::do_attack_effects(Entity attacker, Attack& attack, Entity target, int damage)
 {
-	static std::uniform_real_distribution<float> effect_roller(0, 1);
 	Entity effect_entity = attack.effects;
 
 	while (effect_entity != entt::null) {
 		EffectEntry effect = registry.get<EffectEntry>(effect_entity);
-		if (effect_roller(*rng) <= effect.chance) {
+		if (CombatRules::roll_effect(effect.chance, *rng)) {
 			switch (effect.effect) {
 			case Effect::Shove: {
 				try_shove(attacker, effect, target);
 				break;
 			}
 			case Effect::Crit: {
-				registry.get<Stats>(target).health -= damage * (effect.magnitude - 1);
+				registry.get<Stats>(target).health -= CombatRules::crit_damage(damage, effect.magnitude);
 				break;
 			}
 			default: {
 				auto effect_index = (size_t)effect.effect;
 				assert(effect_index < num_conditions);
 				ActiveConditions& conditions = registry.get_or_emplace<ActiveConditions>(target);
-				conditions.conditions.at(effect_index) = max(effect.magnitude, conditions.conditions.at(effect_index));
+				conditions.conditions.at(effect_index)
+					= CombatRules::stack_condition(conditions.conditions.at(effect_index), effect.magnitude);
 				break;
 			}
 			}
@@ -14,7 +14,7 @@
 class CombatSystem {
 public:
 
-	void init(std::shared_ptr<std::default_random_engine> global_rng,
+	void init(std::shared_ptr<std::default_random_engine> random_stream,
 			  std::shared_ptr<AnimationSystem> animation_system,
 			  std::shared_ptr<LootSystem> loot_system,
 			  std::shared_ptr<MapGeneratorSystem> map_generator_system,
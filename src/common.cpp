@@ -72,4 +72,4 @@ bool gl_has_errors()
 	return true;
 }
 
-entt::registry registry;// NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local entt::registry registry;// NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
@@ -71,6 +71,9 @@ static constexpr int window_height_px = 1080;
 static constexpr ivec2 window_default_size = vec2(window_width_px, window_height_px);
 static constexpr float window_default_scale = 0.5;
 
+// Length of a simulation tick, independent of how often frames are drawn
+static constexpr float tick_ms = 1000.f / 60.f;
+
 namespace AnimationUtility {
 // Defines default colors for enemies of red/blue while active
 static constexpr vec3 default_enemy_red = { 4, 1, 1 };
@@ -229,6 +232,8 @@ edge of map)
 
 */
 
-extern entt::registry registry; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+// Each thread has its own registry, so every thread can run a game of its own
+// A game's systems must be created, stepped and destroyed on the thread whose registry they use
+extern thread_local entt::registry registry; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
 using Entity = entt::entity;
@@ -18,6 +18,8 @@ struct Player {
 struct Debug {
 	bool in_debug_mode = false;
 	bool in_freeze_mode = false;
+	// Draws the profiler's percentiles over the game, in builds with the profiler
+	bool show_profiler = false;
 };
 
 //---------------------------------------------------------------------------
@@ -199,7 +201,17 @@ enum class EFFECT_ASSET_ID {
 	LIGHT_TRIANGLES = LIGHT + 1,
 	LIGHTING = LIGHT_TRIANGLES + 1,
 	COMBAT_COND = LIGHTING + 1,
-	EFFECT_COUNT = COMBAT_COND + 1,
+	// Instanced variants used to draw many sprites at once
+	ENEMY_INSTANCED = COMBAT_COND + 1,
+	PLAYER_INSTANCED = ENEMY_INSTANCED + 1,
+	SPRITESHEET_INSTANCED = PLAYER_INSTANCED + 1,
+	// Draws the whole level's tiles from a tile index texture
+	LEVEL_TILE_MAP = SPRITESHEET_INSTANCED + 1,
+	// Instanced variants of the overlays drawn over world entities
+	HEALTH_INSTANCED = LEVEL_TILE_MAP + 1,
+	FANCY_HEALTH_INSTANCED = HEALTH_INSTANCED + 1,
+	COMBAT_COND_INSTANCED = FANCY_HEALTH_INSTANCED + 1,
+	EFFECT_COUNT = COMBAT_COND_INSTANCED + 1,
 };
 constexpr int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
@@ -216,7 +228,10 @@ enum class GEOMETRY_BUFFER_ID : uint8_t {
 	SCREEN_TRIANGLE = DEBUG_LINE + 1,
 	ROOM = SCREEN_TRIANGLE + 1,
 	LIGHTING_TRIANGLES = ROOM + 1,
-	GEOMETRY_COUNT = LIGHTING_TRIANGLES + 1,
+	STATIC_LIGHT_MASK = LIGHTING_TRIANGLES + 1,
+	DYNAMIC_LIGHT_MASK = STATIC_LIGHT_MASK + 1,
+	TEXT_GLYPHS = DYNAMIC_LIGHT_MASK + 1,
+	GEOMETRY_COUNT = TEXT_GLYPHS + 1,
 };
 const int geometry_count = (int)GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
@@ -266,6 +281,20 @@ struct Light {
 	float radius;
 };
 
+// Denotes a light that never moves, such as a torch or fire tile, so its mask only needs computing once per level
+struct StaticLight {
+};
+
+// The tiles a light actually reaches once walls are taken into account
+struct LightMask {
+	std::vector<uvec2> tiles;
+	// Matches LevelConfiguration::occlusion_version of the level the mask was computed on
+	unsigned int occlusion_version = 0;
+	// Where the light stood and how far it reached in tiles, so a light that hasn't moved keeps its mask
+	uvec2 origin = { 0, 0 };
+	int radius = 0;
+};
+
 //---------------------------------------------------------------------------
 //-------------------------           AI            -------------------------
 //---------------------------------------------------------------------------
@@ -942,6 +971,11 @@ struct WorldPosition {
 	vec2 position;
 };
 
+// Where a moving entity was before the last simulation tick, so frames drawn between ticks can blend its position
+struct PreviousWorldPosition {
+	vec2 position;
+};
+
 //---------------------------------------------------------------------------
 //-------------------------           UI            -------------------------
 //---------------------------------------------------------------------------
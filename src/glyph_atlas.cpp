@@ -0,0 +1,187 @@
+#include "glyph_atlas.hpp"
+
+#include "profiler.hpp"
+
+void GlyphAtlas::build(TTF_Font* new_font)
+{
+	font = new_font;
+	line_height = TTF_FontHeight(font);
+
+	// Each glyph renders to a cell as tall as the font, so they pack into shelves of that height
+	std::array<SDL_Surface*, glyph_count> surfaces = {};
+	ivec2 pen = ivec2(0);
+	for (size_t i = 0; i < glyphs.size(); i++) {
+		char c = static_cast<char>(first_glyph + i);
+		Glyph& glyph = glyphs.at(i);
+
+		int minx = 0;
+		TTF_GlyphMetrics(font, static_cast<Uint16>(c), &minx, nullptr, nullptr, nullptr, &glyph.advance);
+		glyph.offset_x = min(minx, 0);
+
+		SDL_Surface* surface = TTF_RenderGlyph_Blended(font, static_cast<Uint16>(c), SDL_Color({ 255, 255, 255, 255 }));
+		if (surface == nullptr) {
+			fprintf(stderr, "Error TTF_RenderGlyph %c\n", c);
+			continue;
+		}
+		surfaces.at(i) = surface;
+		glyph.size = ivec2(surface->w, surface->h);
+
+		if (pen.x + glyph.size.x > atlas_width) {
+			pen = ivec2(0, pen.y + line_height + 1);
+		}
+		glyph.atlas_pos = pen;
+		// Leave a gap so neighbouring glyphs never bleed into each other
+		pen.x += glyph.size.x + 1;
+	}
+	texture_size = ivec2(atlas_width, pen.y + line_height);
+
+	std::vector<uint32> pixels(static_cast<size_t>(texture_size.x * texture_size.y), 0);
+	for (size_t i = 0; i < glyphs.size(); i++) {
+		SDL_Surface* surface = surfaces.at(i);
+		if (surface == nullptr) {
+			continue;
+		}
+		const Glyph& glyph = glyphs.at(i);
+		SDL_LockSurface(surface);
+		for (int y = 0; y < glyph.size.y; y++) {
+			const auto* row = reinterpret_cast<const uint32*>(static_cast<const uint8*>(surface->pixels) + y * surface->pitch);
+			std::copy(row, row + glyph.size.x, &pixels.at(glyph.atlas_pos.x + (glyph.atlas_pos.y + y) * texture_size.x));
+		}
+		SDL_UnlockSurface(surface);
+		SDL_FreeSurface(surface);
+	}
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D,
+				 0,
+				 GL_RGBA,
+				 texture_size.x,
+				 texture_size.y,
+				 0,
+				 GL_BGRA,
+				 GL_UNSIGNED_INT_8_8_8_8_REV,
+				 pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_has_errors();
+}
+
+void GlyphAtlas::destroy()
+{
+	if (texture != 0) {
+		glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::get_glyph(char c) const
+{
+	if (c < first_glyph || c > last_glyph) {
+		c = '?';
+	}
+	return glyphs.at(static_cast<size_t>(c - first_glyph));
+}
+
+int GlyphAtlas::measure(const std::string& text, size_t start, size_t end) const
+{
+	int pen = 0;
+	int left = 0;
+	int right = 0;
+	for (size_t i = start; i < end; i++) {
+		if (i > start) {
+			pen += TTF_GetFontKerningSizeGlyphs(font, static_cast<Uint16>(text[i - 1]), static_cast<Uint16>(text[i]));
+		}
+		const Glyph& glyph = get_glyph(text[i]);
+		left = min(left, pen + glyph.offset_x);
+		right = max(right, pen + glyph.offset_x + glyph.size.x);
+		pen += glyph.advance;
+	}
+	return max(right, pen) - left;
+}
+
+ivec2 GlyphAtlas::layout(const std::string& text,
+						 int wrap_width,
+						 std::vector<TexturedVertex>& vertices,
+						 std::vector<uint16_t>& indices) const
+{
+	PROFILE_SCOPE("text layout");
+	// Split into lines first, each paragraph is wrapped at the last space that keeps it within wrap_width
+	std::vector<std::pair<size_t, size_t>> lines;
+	size_t start = 0;
+	while (start <= text.size()) {
+		size_t end = min(text.find('\n', start), text.size());
+		// Blank lines are dropped, as they were when each paragraph was rendered separately
+		while (start < end) {
+			size_t line_end = end;
+			if (measure(text, start, end) > wrap_width) {
+				size_t space = text.find(' ', start);
+				size_t last_fit = std::string::npos;
+				while (space < end && measure(text, start, space) <= wrap_width) {
+					last_fit = space;
+					space = text.find(' ', space + 1);
+				}
+				if (last_fit != std::string::npos) {
+					line_end = last_fit;
+				} else if (space < end) {
+					// A single word wider than the wrap width gets a line of its own
+					line_end = space;
+				}
+			}
+			if (line_end > start) {
+				lines.emplace_back(start, line_end);
+			}
+			start = (line_end == end) ? end : line_end + 1;
+		}
+		start = end + 1;
+	}
+
+	// Lay the glyphs out in pixels, then normalize once the block's size is known
+	size_t first_vertex = vertices.size();
+	ivec2 size = ivec2(0, static_cast<int>(lines.size()) * line_height);
+	vec2 texel = 1.f / vec2(texture_size);
+	for (size_t line = 0; line < lines.size(); line++) {
+		auto [line_start, line_end] = lines.at(line);
+		int line_width = measure(text, line_start, line_end);
+		size.x = max(size.x, line_width);
+
+		int pen = 0;
+		int left = 0;
+		for (size_t i = line_start; i < line_end; i++) {
+			left = min(left, pen + get_glyph(text[i]).offset_x);
+			pen += get_glyph(text[i]).advance;
+		}
+		pen = -left;
+		float top = static_cast<float>(line) * static_cast<float>(line_height);
+		for (size_t i = line_start; i < line_end; i++) {
+			if (i > line_start) {
+				pen += TTF_GetFontKerningSizeGlyphs(font, static_cast<Uint16>(text[i - 1]), static_cast<Uint16>(text[i]));
+			}
+			const Glyph& glyph = get_glyph(text[i]);
+			if (text[i] != ' ' && glyph.size.x > 0) {
+				vec2 min_pos = vec2(static_cast<float>(pen + glyph.offset_x), top);
+				vec2 max_pos = min_pos + vec2(glyph.size);
+				vec2 min_uv = vec2(glyph.atlas_pos) * texel;
+				vec2 max_uv = vec2(glyph.atlas_pos + glyph.size) * texel;
+
+				auto base = static_cast<uint16_t>(vertices.size());
+				vertices.push_back({ vec3(min_pos.x, max_pos.y, 0), vec2(min_uv.x, max_uv.y) });
+				vertices.push_back({ vec3(max_pos, 0), max_uv });
+				vertices.push_back({ vec3(max_pos.x, min_pos.y, 0), vec2(max_uv.x, min_uv.y) });
+				vertices.push_back({ vec3(min_pos, 0), min_uv });
+				for (uint16_t index : { 0, 3, 1, 1, 3, 2 }) {
+					indices.push_back(static_cast<uint16_t>(base + index));
+				}
+			}
+			pen += glyph.advance;
+		}
+	}
+
+	vec2 block = max(vec2(size), vec2(1));
+	for (size_t i = first_vertex; i < vertices.size(); i++) {
+		vec3& position = vertices.at(i).position;
+		position = vec3(vec2(position) / block - .5f, 0);
+	}
+	return size;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "common.hpp"
+#include "components.hpp"
+
+#include <SDL_ttf.h>
+
+// Every printable ASCII glyph of one font at one size, rasterized once into a single texture.
+// Strings are laid out into quads against it, so drawing new text never needs a new texture.
+class GlyphAtlas {
+public:
+	// Rasterizes the glyphs and uploads them, expects a current GL context
+	void build(TTF_Font* font);
+	void destroy();
+
+	GLuint get_texture() const { return texture; }
+
+	// Lays the string out the way TTF_RenderText_Blended_Wrapped would, breaking lines on newlines and
+	// wrapping words that would go past wrap_width. Quads are appended to vertices and indices in a space where
+	// the whole block spans [-.5, .5], matching the sprite quad, and the block's size in pixels is returned.
+	ivec2 layout(const std::string& text,
+				 int wrap_width,
+				 std::vector<TexturedVertex>& vertices,
+				 std::vector<uint16_t>& indices) const;
+
+private:
+	static constexpr char first_glyph = ' ';
+	static constexpr char last_glyph = '~';
+	static constexpr size_t glyph_count = last_glyph - first_glyph + 1;
+	static constexpr int atlas_width = 512;
+
+	struct Glyph {
+		// Where the glyph's cell is in the atlas, and its size in pixels
+		ivec2 atlas_pos = ivec2(0);
+		ivec2 size = ivec2(0);
+		// Horizontal offset of the cell from the pen position, negative for glyphs that overhang to the left
+		int offset_x = 0;
+		int advance = 0;
+	};
+	const Glyph& get_glyph(char c) const;
+	// Width of a run of characters on a single line
+	int measure(const std::string& text, size_t start, size_t end) const;
+
+	TTF_Font* font = nullptr;
+	GLuint texture = 0;
+	ivec2 texture_size = ivec2(0);
+	int line_height = 0;
+	std::array<Glyph, glyph_count> glyphs = {};
+};
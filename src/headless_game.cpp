@@ -0,0 +1,81 @@
+#include "headless_game.hpp"
+
+// stlib
+#include <mutex>
+
+namespace {
+// SDL_ttf's setup and gl3w's function pointers are shared by the whole process
+std::mutex renderer_init_mutex;
+
+// Audio core that mixes nothing and needs no device
+std::shared_ptr<SoLoud::Soloud> create_null_audio()
+{
+	std::shared_ptr<SoLoud::Soloud> so_loud = std::make_shared<SoLoud::Soloud>();
+	so_loud->init(SoLoud::Soloud::CLIP_ROUNDOFF, SoLoud::Soloud::NULLDRIVER);
+	return so_loud;
+}
+} // namespace
+
+HeadlessGame::HeadlessGame(uint64_t seed, size_t lighting_workers, bool skip_main_menu)
+	: so_loud(create_null_audio())
+	, random(std::make_shared<RandomStreams>(seed))
+	, music(std::make_shared<MusicSystem>(so_loud))
+	, loot(std::make_shared<LootSystem>())
+	, combat(std::make_shared<CombatSystem>())
+	, turns(std::make_shared<TurnSystem>())
+	, tutorials(std::make_shared<TutorialSystem>())
+	, animations(std::make_shared<AnimationSystem>())
+	, ui(std::make_shared<UISystem>(debugging))
+	, map(std::make_shared<MapGeneratorSystem>(loot, turns, tutorials, ui, so_loud))
+	, stories(std::make_shared<StorySystem>(animations, map, music))
+	, world(debugging, animations, combat, loot, map, music, stories, turns, tutorials, ui, so_loud, random)
+	, lighting(tutorials, lighting_workers)
+	, renderer(debugging, lighting)
+	, physics(debugging, map)
+	, ai(debugging, animations, combat, lighting, map, turns, so_loud, *random)
+{
+	{
+		std::lock_guard<std::mutex> lock(renderer_init_mutex);
+		renderer.init(window_width_px, window_height_px, nullptr, map, &recorder);
+	}
+	world.init(&renderer);
+	lighting.init(map);
+	if (skip_main_menu) {
+		ui->start_game();
+	}
+}
+
+HeadlessGame::~HeadlessGame() { so_loud->deinit(); }
+
+void HeadlessGame::restart(uint64_t seed)
+{
+	world.restart_game(seed);
+	ui->start_game();
+	ticks = 0;
+}
+
+void HeadlessGame::set_turbo(bool enabled)
+{
+	world.set_turbo(enabled);
+	animations->set_turbo(enabled);
+	physics.set_turbo(enabled);
+}
+
+void HeadlessGame::tick()
+{
+	using System = SystemTimings::System;
+	PROFILE_SCOPE("tick");
+	timings.time(System::World, [&]() { world.step(tick_ms); });
+	timings.time(System::AI, [&]() { ai.step(tick_ms); });
+	timings.time(System::Physics, [&]() { physics.step(tick_ms, window_width_px, window_height_px); });
+	timings.time(System::Collisions, [&]() { world.handle_collisions(); });
+	timings.time(System::Animations, [&]() { animations->update_animations(tick_ms, turns->get_inactive_color()); });
+	timings.time(System::Map, [&]() { map->step(tick_ms); });
+	timings.time(System::Turns, [&]() { turns->step(); });
+	timings.time(System::Music, [&]() { music->step(tick_ms); });
+	timings.time(System::Lighting, [&]() { lighting.step(tick_ms); });
+
+	// Nothing reads the calls back, so don't let them pile up over a long batch
+	recorder.clear();
+	ticks++;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ai_system.hpp"
+#include "animation_system.hpp"
+#include "combat_system.hpp"
+#include "lighting_system.hpp"
+#include "loot_system.hpp"
+#include "map_generator_system.hpp"
+#include "music_system.hpp"
+#include "physics_system.hpp"
+#include "random_streams.hpp"
+#include "recording_gl_backend.hpp"
+#include "render_system.hpp"
+#include "story_system.hpp"
+#include "system_timings.hpp"
+#include "turn_system.hpp"
+#include "tutorial_system.hpp"
+#include "ui_system.hpp"
+#include "world_system.hpp"
+
+// The whole game without a window, GL context or audio device, for running simulated games in batches.
+// The renderer is set up against a RecordingGLBackend and never draws, sound goes to SoLoud's null driver,
+// and input is passed straight to the WorldSystem handlers that GLFW would otherwise call.
+// Each game is its own set of systems over its thread's registry, so any number can run at once as long as each
+// has a thread to itself and is created, ticked and destroyed there.
+class HeadlessGame {
+public:
+	// Games sharing the machine with others should pass few lighting workers, or none
+	// Replays of windowed sessions keep the main menu, since the recorded clicks start the game
+	explicit HeadlessGame(uint64_t seed,
+						  size_t lighting_workers = ThreadPool::hardware_workers,
+						  bool skip_main_menu = true);
+	~HeadlessGame();
+	HeadlessGame(const HeadlessGame&) = delete;
+	HeadlessGame& operator=(const HeadlessGame&) = delete;
+	HeadlessGame(HeadlessGame&&) = delete;
+	HeadlessGame& operator=(HeadlessGame&&) = delete;
+
+	// Starts a new game from the given seed and skips past the main menu
+	void restart(uint64_t seed);
+
+	// Turbo mode finishes event animations and projectile flights as soon as they start, so a turn takes a tick
+	// rather than as long as its animations would play, the outcome of each action is unchanged
+	void set_turbo(bool enabled);
+
+	// Advances one simulation tick, running the systems in the same order as the windowed loop
+	void tick();
+
+	// Ticks run since the last restart
+	size_t get_tick() const { return ticks; }
+
+	WorldSystem& get_world() { return world; }
+	const WorldSystem& get_world() const { return world; }
+	const MapGeneratorSystem& get_map() const { return *map; }
+	const UISystem& get_ui() const { return *ui; }
+	const LightingSystem& get_lighting() const { return lighting; }
+	const SystemTimings& get_timings() const { return timings; }
+
+private:
+	size_t ticks = 0;
+	SystemTimings timings;
+
+	// Declared first so it outlives everything that may still call into GL
+	RecordingGLBackend recorder;
+	Debug debugging;
+	std::shared_ptr<SoLoud::Soloud> so_loud;
+	std::shared_ptr<RandomStreams> random;
+
+	std::shared_ptr<MusicSystem> music;
+	std::shared_ptr<LootSystem> loot;
+	std::shared_ptr<CombatSystem> combat;
+	std::shared_ptr<TurnSystem> turns;
+	std::shared_ptr<TutorialSystem> tutorials;
+	std::shared_ptr<AnimationSystem> animations;
+	std::shared_ptr<UISystem> ui;
+	std::shared_ptr<MapGeneratorSystem> map;
+	std::shared_ptr<StorySystem> stories;
+
+	WorldSystem world;
+	LightingSystem lighting;
+	RenderSystem renderer;
+	PhysicsSystem physics;
+	AISystem ai;
+};
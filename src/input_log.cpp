@@ -0,0 +1,198 @@
+#include "input_log.hpp"
+
+// stlib
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+constexpr std::array<char, 4> magic = { 'P', 'S', 'I', 'N' };
+constexpr uint8_t version = 1;
+
+// Little endian base 128, small numbers take a single byte
+void write_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+// Keeps small negative numbers, e.g. GLFW_KEY_UNKNOWN, to a single byte too
+void write_signed(std::vector<uint8_t>& out, int value)
+{
+	auto wide = static_cast<int64_t>(value);
+	write_varint(out, (static_cast<uint64_t>(wide) << 1) ^ static_cast<uint64_t>(wide >> 63));
+}
+
+void write_float(std::vector<uint8_t>& out, float value)
+{
+	uint32_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	for (int i = 0; i < 4; i++) {
+		out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+	}
+}
+
+class Reader {
+public:
+	explicit Reader(const std::vector<uint8_t>& data)
+		: data(data)
+	{
+	}
+
+	bool failed() const { return failure; }
+	bool at_end() const { return next >= data.size(); }
+
+	uint8_t read_byte()
+	{
+		if (at_end()) {
+			failure = true;
+			return 0;
+		}
+		return data.at(next++);
+	}
+
+	uint64_t read_varint()
+	{
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t byte = read_byte();
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) {
+				return value;
+			}
+		}
+		failure = true;
+		return value;
+	}
+
+	int read_signed()
+	{
+		uint64_t value = read_varint();
+		return static_cast<int>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+	}
+
+	float read_float()
+	{
+		uint32_t bits = 0;
+		for (int i = 0; i < 4; i++) {
+			bits |= static_cast<uint32_t>(read_byte()) << (8 * i);
+		}
+		float value = 0;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+private:
+	const std::vector<uint8_t>& data;
+	size_t next = 0;
+	bool failure = false;
+};
+} // namespace
+
+bool InputLog::save(const std::string& path) const
+{
+	std::vector<uint8_t> out(magic.begin(), magic.end());
+	out.push_back(version);
+	write_varint(out, seed);
+	write_varint(out, end_tick);
+	write_varint(out, events.size());
+
+	uint64_t tick = 0;
+	for (const InputEvent& event : events) {
+		out.push_back(static_cast<uint8_t>(event.type));
+		write_varint(out, event.tick - tick);
+		tick = event.tick;
+		switch (event.type) {
+		case InputEvent::Type::Key:
+		case InputEvent::Type::Click:
+			write_signed(out, event.code);
+			write_signed(out, event.action);
+			write_signed(out, event.mods);
+			break;
+		case InputEvent::Type::Move:
+			write_float(out, event.position.x);
+			write_float(out, event.position.y);
+			break;
+		case InputEvent::Type::Scroll:
+			write_float(out, event.position.y);
+			break;
+		case InputEvent::Type::Resize:
+			write_signed(out, event.code);
+			write_signed(out, event.action);
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+	if (!file.good()) {
+		fprintf(stderr, "Failed to write input log %s\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool InputLog::load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		fprintf(stderr, "Failed to open input log %s\n", path.c_str());
+		return false;
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (data.size() < magic.size() + 1 || !std::equal(magic.begin(), magic.end(), data.begin())
+		|| data.at(magic.size()) != version) {
+		fprintf(stderr, "%s is not a version %d input log\n", path.c_str(), version);
+		return false;
+	}
+
+	Reader reader(data);
+	for (size_t i = 0; i <= magic.size(); i++) {
+		reader.read_byte();
+	}
+	seed = reader.read_varint();
+	end_tick = reader.read_varint();
+	uint64_t count = reader.read_varint();
+
+	events.clear();
+	uint64_t tick = 0;
+	for (uint64_t i = 0; i < count && !reader.failed(); i++) {
+		InputEvent event;
+		event.type = static_cast<InputEvent::Type>(reader.read_byte());
+		tick += reader.read_varint();
+		event.tick = tick;
+		switch (event.type) {
+		case InputEvent::Type::Key:
+		case InputEvent::Type::Click:
+			event.code = reader.read_signed();
+			event.action = reader.read_signed();
+			event.mods = reader.read_signed();
+			break;
+		case InputEvent::Type::Move:
+			event.position.x = reader.read_float();
+			event.position.y = reader.read_float();
+			break;
+		case InputEvent::Type::Scroll:
+			event.position.y = reader.read_float();
+			break;
+		case InputEvent::Type::Resize:
+			event.code = reader.read_signed();
+			event.action = reader.read_signed();
+			break;
+		default:
+			fprintf(stderr, "%s: unknown event type %d\n", path.c_str(), static_cast<int>(event.type));
+			return false;
+		}
+		events.push_back(event);
+	}
+	if (reader.failed()) {
+		fprintf(stderr, "%s is truncated\n", path.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.hpp"
+
+// stlib
+#include <string>
+#include <vector>
+
+// One input as it reached WorldSystem, and how many simulation ticks had run when it did
+struct InputEvent {
+	enum class Type : uint8_t {
+		Key = 0,
+		Click = Key + 1,
+		Move = Click + 1,
+		Scroll = Move + 1,
+		Resize = Scroll + 1,
+		Count = Resize + 1,
+	};
+	uint64_t tick = 0;
+	Type type = Type::Key;
+	// GLFW key or mouse button, action and mods, for a resize the new width and height are in code and action
+	int code = 0;
+	int action = 0;
+	int mods = 0;
+	// Cursor position in window pixels, or the scroll offset in y
+	vec2 position = vec2(0);
+};
+
+// Every input of a session plus the seed it started from, which together replay the session exactly.
+// Saved as a small binary file: a header with the seed and length, then each event with its tick stored as the
+// distance from the previous event's, so a long session of mostly idle ticks stays small.
+class InputLog {
+public:
+	InputLog() = default;
+	explicit InputLog(uint64_t seed)
+		: seed(seed)
+	{
+	}
+
+	void record(const InputEvent& event) { events.push_back(event); }
+	// Ticks the session ran for, replays stop here rather than at the last input
+	void set_end_tick(uint64_t tick) { end_tick = tick; }
+
+	uint64_t get_seed() const { return seed; }
+	uint64_t get_end_tick() const { return end_tick; }
+	const std::vector<InputEvent>& get_events() const { return events; }
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+
+private:
+	uint64_t seed = 0;
+	uint64_t end_tick = 0;
+	std::vector<InputEvent> events;
+};
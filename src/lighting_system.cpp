@@ -1,34 +1,43 @@
 #include "lighting_system.hpp"
 
 #include "geometry.hpp"
+#include "profiler.hpp"
 
 #include <glm/gtx/rotate_vector.hpp>
 
+// stlib
+#include <algorithm>
+
 void LightingSystem::init(std::shared_ptr<MapGeneratorSystem> map)
 {
+	// The renderer initialises it too
+	if (map == map_generator) {
+		return;
+	}
 	this->map_generator = std::move(map);
+	// Builds each level's visibility table as it loads rather than on its first step
+	map_generator->on_level_load([this](int /*level*/) {
+		drop_stale_caches();
+		update_visibility_table();
+	});
 }
 
-void light_tile(uvec2 pos)
+void LightingSystem::light_tile(uvec2 pos)
 {
 	const static vec3 color(1);
-	Entity entity = registry.create();
-	registry.emplace<LightingTile>(entity);
-	registry.emplace<WorldPosition>(entity, MapUtility::map_position_to_world_position(pos));
-	registry.emplace<Color>(entity, color);
-	registry.emplace<UIRectangle>(entity, 1.f, vec4(color, 1));
+	Entity entity = lit_wall_pool.acquire();
+	registry.emplace_or_replace<WorldPosition>(entity, MapUtility::map_position_to_world_position(pos));
+	registry.emplace_or_replace<Color>(entity, color);
+	registry.emplace_or_replace<UIRectangle>(entity, 1.f, vec4(color, 1));
 }
 
-void light_triangle(vec2 p1, vec2 p2, vec2 p3)
-{
-	Entity entity = registry.create();
-	registry.emplace<LightingTriangle>(entity, p1, p2, p3);
-}
+void LightingSystem::light_triangle(vec2 p1, vec2 p2, vec2 p3) { triangle_pool.acquire(p1, p2, p3); }
 
 void LightingSystem::step(float elapsed_ms)
 {
-	registry.destroy(registry.view<LightingTriangle>().begin(), registry.view<LightingTriangle>().end());
-	registry.destroy(registry.view<LightingTile>().begin(), registry.view<LightingTile>().end());
+	// Both are made afresh every tick, from the entities of the last one
+	triangle_pool.release_all();
+	lit_wall_pool.release_all();
 	Entity player = registry.view<Player>().front();
 	vec2 player_world_pos;
 	uvec2 player_map_pos;
@@ -48,84 +57,267 @@ void LightingSystem::step(float elapsed_ms)
 	for (auto [entity, room, animation] : registry.view<Room, RoomAnimation>().each()) {
 		animation.elapsed_time += elapsed_ms;
 		auto area = MapUtility::get_room_area(room.room_index);
-		float max_dist = animation.dist_per_second * (animation.elapsed_time / 1000.f);
+		// The reveal is drawn per pixel, so it has to pass the corner tiles' far edges, within a tile of their centres
+		float max_dist = animation.dist_per_second * (animation.elapsed_time / 1000.f) - MapUtility::tile_size;
 
 		// Check if the whole thing is revealed
-		if (check_distance(animation.start_tile, area.first, max_dist)
+		if (max_dist >= 0 && check_distance(animation.start_tile, area.first, max_dist)
 			&& check_distance(animation.start_tile, area.second, max_dist)
 			&& check_distance(animation.start_tile, uvec2(area.first.x, area.second.y), max_dist)
 			&& check_distance(animation.start_tile, uvec2(area.second.x, area.first.y), max_dist)) {
-			//registry.remove<RoomAnimation>(entity);
+			registry.remove<RoomAnimation>(entity);
 		}
 	}
 
-	spin(player_map_pos, player_world_pos);
+	drop_stale_caches();
+	update_visibility_table();
+	spin_lights(player, player_map_pos, player_world_pos);
 }
 
-bool LightingSystem::is_visible(uvec2 tile) { return visible_tiles.count(tile) > 0; }
+bool LightingSystem::is_visible(uvec2 tile) const { return visible_tiles.count(tile) > 0; }
+
+bool LightingSystem::is_visible_from(uvec2 from, uvec2 to) const
+{
+	if (use_visibility_table) {
+		auto table = visibility_tables.find(map_generator->get_current_level());
+		if (table != visibility_tables.end()
+			&& table->second.occlusion_version == map_generator->get_occlusion_version()) {
+			if (const VisibilityTable::VisibleSet* set = table->second.find(from)) {
+				return set->contains(to);
+			}
+		}
+	}
+	if (from == visible_tiles_origin) {
+		return visible_tiles.count(to) > 0;
+	}
+	FieldOfView fov = { MapUtility::map_position_to_world_position(from), light_radius };
+	spin(fov, from);
+	return std::find(fov.visible_tiles.begin(), fov.visible_tiles.end(), to) != fov.visible_tiles.end();
+}
+
+LightingSystem::FieldOfViewStats LightingSystem::compute_field_of_view(uvec2 origin_map_pos) const
+{
+	FieldOfView fov = { MapUtility::map_position_to_world_position(origin_map_pos), light_radius, true };
+	spin(fov, origin_map_pos);
+	return { fov.visible_tiles.size(), fov.triangles.size() };
+}
+
+void LightingSystem::drop_stale_caches()
+{
+	if (layout_generation != map_generator->get_layout_generation()) {
+		layout_generation = map_generator->get_layout_generation();
+		visibility_tables.clear();
+		static_light_masks.clear();
+	}
+}
+
+void LightingSystem::update_visibility_table()
+{
+	if (!use_visibility_table) {
+		return;
+	}
+	int level = map_generator->get_current_level();
+	unsigned int occlusion_version = map_generator->get_occlusion_version();
+	VisibilityTable& table = visibility_tables[level];
+	if (table.built() && table.occlusion_version == occlusion_version) {
+		return;
+	}
+
+	VisibilityTable::OpacityGrid opacity;
+	VisibilityTable::OpacityGrid walkable;
+	for (uint y = 0; y < VisibilityTable::map_tiles; y++) {
+		for (uint x = 0; x < VisibilityTable::map_tiles; x++) {
+			MapUtility::TileID tile_id = map_generator->get_tile_id_from_map_pos(uvec2(x, y));
+			opacity.set(VisibilityTable::index(uvec2(x, y)), MapUtility::is_opaque_tile(tile_id));
+			walkable.set(VisibilityTable::index(uvec2(x, y)), MapUtility::is_walkable_tile(tile_id));
+		}
+	}
 
-void LightingSystem::spin(uvec2 player_map_pos, vec2 player_world_pos)
+	std::vector<uvec2> to_compute;
+	if (!table.built()) {
+		table.reset(level, occlusion_version, opacity);
+		for (uint y = 0; y < VisibilityTable::map_tiles; y++) {
+			for (uint x = 0; x < VisibilityTable::map_tiles; x++) {
+				to_compute.emplace_back(x, y);
+			}
+		}
+	} else {
+		// Only the sets that could see a changed tile can have changed, plus the changed tiles themselves
+		std::vector<uvec2> changed;
+		for (uint y = 0; y < VisibilityTable::map_tiles; y++) {
+			for (uint x = 0; x < VisibilityTable::map_tiles; x++) {
+				if (table.opaque.test(VisibilityTable::index(uvec2(x, y)))
+					!= opacity.test(VisibilityTable::index(uvec2(x, y)))) {
+					changed.emplace_back(x, y);
+				}
+			}
+		}
+		to_compute = table.tiles_seeing_any(changed);
+		for (const uvec2& tile : changed) {
+			table.remove(tile);
+			to_compute.push_back(tile);
+		}
+		table.opaque = opacity;
+		table.occlusion_version = occlusion_version;
+	}
+
+	// Each set is written by exactly one job, so drop duplicates and tiles nobody can stand on
+	auto by_index = [](uvec2 a, uvec2 b) { return VisibilityTable::index(a) < VisibilityTable::index(b); };
+	std::sort(to_compute.begin(), to_compute.end(), by_index);
+	to_compute.erase(std::unique(to_compute.begin(), to_compute.end()), to_compute.end());
+	to_compute.erase(std::remove_if(to_compute.begin(),
+									to_compute.end(),
+									[&walkable](uvec2 tile) { return !walkable.test(VisibilityTable::index(tile)); }),
+					 to_compute.end());
+
+	pool.parallel_for(to_compute.size(), [&](size_t i) {
+		uvec2 tile = to_compute.at(i);
+		FieldOfView fov = { MapUtility::map_position_to_world_position(tile), light_radius };
+		spin(fov, tile);
+		table.at(tile).assign(fov.visible_tiles);
+	});
+}
+
+void LightingSystem::spin_lights(Entity player, uvec2 player_map_pos, vec2 player_world_pos)
 {
-	visited_angles.clear();
+	struct LightJob {
+		Entity entity;
+		uvec2 map_pos;
+		FieldOfView fov;
+	};
+	std::vector<LightJob> jobs;
+	jobs.push_back({ player, player_map_pos, { player_world_pos, light_radius, true } });
+
+	int level = map_generator->get_current_level();
+	unsigned int occlusion_version = map_generator->get_occlusion_version();
+	auto& level_static_masks = static_light_masks[level];
+
+	for (auto [entity, light] : registry.view<Light>().each()) {
+		if (entity == player) {
+			continue;
+		}
+		uvec2 map_pos;
+		vec2 world_pos;
+		if (WorldPosition* light_world_pos = registry.try_get<WorldPosition>(entity)) {
+			world_pos = light_world_pos->position;
+			map_pos = MapUtility::world_position_to_map_position(world_pos);
+		} else {
+			map_pos = registry.get<MapPosition>(entity).position;
+			world_pos = MapUtility::map_position_to_world_position(map_pos);
+		}
+
+		auto radius = static_cast<int>(ceil(light.radius / MapUtility::tile_size)) + 1;
+		LightMask* mask = registry.try_get<LightMask>(entity);
+		if (mask != nullptr && mask->occlusion_version == occlusion_version && mask->origin == map_pos
+			&& mask->radius == radius) {
+			continue;
+		}
+		if (registry.all_of<StaticLight>(entity)) {
+			auto cached = level_static_masks.find(map_pos);
+			if (cached != level_static_masks.end() && cached->second.occlusion_version == occlusion_version) {
+				registry.emplace_or_replace<LightMask>(entity, cached->second);
+				static_mask_version++;
+				continue;
+			}
+		}
+
+		jobs.push_back({ entity, map_pos, { world_pos, radius } });
+	}
+
+	// Each field of view only reads the map, so they can all be worked out at once
+	pool.parallel_for(jobs.size(), [&](size_t i) { spin(jobs.at(i).fov, jobs.at(i).map_pos); });
+
+	// Player field of view drives exploration and line of sight
+	FieldOfView& player_fov = jobs.front().fov;
 	visible_tiles.clear();
+	visible_tiles_origin = player_map_pos;
 	visible_rooms.clear();
-	mark_as_visible(player_map_pos);
+	for (const auto& tile : player_fov.visible_tiles) {
+		mark_as_visible(tile);
+	}
+	for (const auto& triangle : player_fov.triangles) {
+		light_triangle(triangle.p1, triangle.p2, triangle.p3);
+	}
+	for (const auto& tile : player_fov.lit_walls) {
+		light_tile(tile);
+	}
+	update_visible();
+
+	for (size_t i = 1; i < jobs.size(); i++) {
+		LightMask& mask = registry.emplace_or_replace<LightMask>(jobs.at(i).entity);
+		mask.tiles = std::move(jobs.at(i).fov.visible_tiles);
+		mask.occlusion_version = occlusion_version;
+		mask.origin = jobs.at(i).map_pos;
+		mask.radius = jobs.at(i).fov.radius;
+		if (registry.all_of<StaticLight>(jobs.at(i).entity)) {
+			level_static_masks.insert_or_assign(jobs.at(i).map_pos, mask);
+			static_mask_version++;
+		} else {
+			dynamic_mask_version++;
+		}
+	}
+}
+
+void LightingSystem::spin(FieldOfView& fov, uvec2 origin_map_pos) const
+{
+	PROFILE_SCOPE("spin");
+	fov.visible_tiles.push_back(origin_map_pos);
 	auto check_point = [&](uvec2 tile) {
 		if (!map_generator->is_on_map(tile) || (tile.x > MapUtility::map_down_right.x || tile.y > MapUtility::map_down_right.y)) {
 			return;
 		}
-		process_tile(player_world_pos, tile);
+		process_tile(fov, tile);
 	};
-	for (int radius = 1; radius < light_radius; radius++) {
+	for (int radius = 1; radius < fov.radius; radius++) {
 		for (int dx = 0; dx <= radius; dx++) {
 			for (int dy = 0; dy + dx <= radius; dy++) {
 				if (dx + dy != radius) {
 					continue;
 				}
-				if (dx * dx + dy * dy >= light_radius * light_radius) {
+				if (dx * dx + dy * dy >= fov.radius * fov.radius) {
 					continue;
 				}
-				check_point(uvec2(player_map_pos.x + dx, player_map_pos.y + dy));
+				check_point(uvec2(origin_map_pos.x + dx, origin_map_pos.y + dy));
 				if (dx != 0 && dy != 0) {
-					check_point(uvec2(player_map_pos.x - dx, player_map_pos.y - dy));
+					check_point(uvec2(origin_map_pos.x - dx, origin_map_pos.y - dy));
 				}
 				if (dx != 0) {
-					check_point(uvec2(player_map_pos.x - dx, player_map_pos.y + dy));
+					check_point(uvec2(origin_map_pos.x - dx, origin_map_pos.y + dy));
 				}
 				if (dy != 0) {
-					check_point(uvec2(player_map_pos.x + dx, player_map_pos.y - dy));
+					check_point(uvec2(origin_map_pos.x + dx, origin_map_pos.y - dy));
 				}
-				if (visited_angles.size() == 1 && visited_angles.at(0).x <= -glm::pi<double>()
-					&& visited_angles.at(0).y >= glm::pi<double>()) {
+				if (fov.visited_angles.size() == 1 && fov.visited_angles.at(0).x <= -glm::pi<double>()
+					&& fov.visited_angles.at(0).y >= glm::pi<double>()) {
 					// We've darkened everything now
-					update_visible();
 					return;
 				}
 			}
 		}
 	}
 
-	for (int i = 0; i <= visited_angles.size(); i++) {
+	if (!fov.emit_geometry) {
+		return;
+	}
+	for (size_t i = 0; i <= fov.visited_angles.size(); i++) {
 		dvec2 angle;
-		angle.x = (i == 0) ? -glm::pi<double>() : visited_angles.at(i - 1).y;
-		angle.y = (i == visited_angles.size()) ? glm::pi<double>() : visited_angles.at(i).x;
+		angle.x = (i == 0) ? -glm::pi<double>() : fov.visited_angles.at(i - 1).y;
+		angle.y = (i == fov.visited_angles.size()) ? glm::pi<double>() : fov.visited_angles.at(i).x;
 		while (angle.x < angle.y) {
-			auto scale = static_cast<double>(2 * light_radius * MapUtility::tile_size);
-			vec2 p2 = player_world_pos + vec2(scale * glm::rotate(dvec2(1, 0), angle.x));
-			vec2 p3 = player_world_pos
+			auto scale = static_cast<double>(2 * fov.radius * MapUtility::tile_size);
+			vec2 p2 = fov.origin + vec2(scale * glm::rotate(dvec2(1, 0), angle.x));
+			vec2 p3 = fov.origin
 				+ vec2(scale * glm::rotate(dvec2(1, 0), min(angle.y, angle.x + glm::pi<double>() / 2.0)));
-			light_triangle(player_world_pos, p2, p3);
+			fov.triangles.push_back({ fov.origin, p2, p3 });
 			angle.x += glm::pi<double>() / 2.0;
 		}
 	}
-	update_visible();
 }
 
-void LightingSystem::process_tile(vec2 player_world_pos, uvec2 tile)
+void LightingSystem::process_tile(FieldOfView& fov, uvec2 tile) const
 {
-	MapUtility::TileID tile_id = map_generator->get_tile_id_from_map_pos(tile);
-	bool is_solid = !map_generator->walkable(tile) && !MapUtility::is_torch_tile(tile_id)
-		&& !MapUtility::is_any_chest_tile(tile_id);
+	bool is_solid = MapUtility::is_opaque_tile(map_generator->get_tile_id_from_map_pos(tile));
+	vec2 player_world_pos = fov.origin;
 	auto min_angle = glm::pi<double>();
 	auto max_angle = -glm::pi<double>();
 	int side = 0;
@@ -159,47 +351,49 @@ void LightingSystem::process_tile(vec2 player_world_pos, uvec2 tile)
 			}
 		}
 		if (is_solid) {
-			AngleResult pos_result = try_add_angle(positive_angle);
-			AngleResult neg_result = try_add_angle(negative_angle);
-			draw_tile(pos_result, positive_angle, tile, player_world_pos);
-			draw_tile(neg_result, negative_angle, tile, player_world_pos);
+			AngleResult pos_result = try_add_angle(fov, positive_angle);
+			AngleResult neg_result = try_add_angle(fov, negative_angle);
+			draw_tile(fov, pos_result, positive_angle, tile);
+			draw_tile(fov, neg_result, negative_angle, tile);
 			result = (AngleResult)((uint)pos_result | (uint)neg_result);
 		} else {
-			result = (AngleResult)((uint)check_visible(positive_angle) | (uint)check_visible(negative_angle));
+			result = (AngleResult)((uint)check_visible(fov, positive_angle) | (uint)check_visible(fov, negative_angle));
 		}
 	} else {
 		dvec2 angle = dvec2(min_angle, max_angle);
 		if (is_solid) {
-			result = try_add_angle(angle);
-			draw_tile(result, angle, tile, player_world_pos);
+			result = try_add_angle(fov, angle);
+			draw_tile(fov, result, angle, tile);
 		} else {
-			result = check_visible(angle);
+			result = check_visible(fov, angle);
 		}
 	}
 	if (result != AngleResult::Redundant) {
-		mark_as_visible(tile);
+		fov.visible_tiles.push_back(tile);
 	}
 }
 
-void LightingSystem::draw_tile(AngleResult result, const dvec2& angle, uvec2 tile, vec2 player_world_pos)
-{ 
+void LightingSystem::draw_tile(FieldOfView& fov, AngleResult result, const dvec2& angle, uvec2 tile) const
+{
+	if (!fov.emit_geometry) {
+		return;
+	}
 	switch (result) {
 	case AngleResult::New: {
-		for (int i = 0; i < offsets.size(); i++) {
+		for (size_t i = 0; i < offsets.size(); i++) {
 			vec2 p2
 				= MapUtility::map_position_to_world_position(tile) + center_offset * vec2(offsets.at(i));
 			vec2 p3 = MapUtility::map_position_to_world_position(tile)
 				+ center_offset * vec2(offsets.at((i + 1) % offsets.size()));
-			light_triangle(player_world_pos, p2, p3);
-			// light_tile(tile);
+			fov.triangles.push_back({ fov.origin, p2, p3 });
 		}
 		break;
 	}
 	case AngleResult::Overlap: {
-		vec2 p2 = project_onto_tile(tile, player_world_pos, angle.x);
-		vec2 p3 = project_onto_tile(tile, player_world_pos, angle.y);
-		light_triangle(player_world_pos, p2, p3);
-		light_tile(tile);
+		vec2 p2 = project_onto_tile(tile, fov.origin, angle.x);
+		vec2 p3 = project_onto_tile(tile, fov.origin, angle.y);
+		fov.triangles.push_back({ fov.origin, p2, p3 });
+		fov.lit_walls.push_back(tile);
 		break;
 	}
 	default:
@@ -207,8 +401,9 @@ void LightingSystem::draw_tile(AngleResult result, const dvec2& angle, uvec2 til
 	}
 }
 
-LightingSystem::AngleResult LightingSystem::try_add_angle(dvec2& angle)
+LightingSystem::AngleResult LightingSystem::try_add_angle(FieldOfView& fov, dvec2& angle) const
 {
+	std::vector<dvec2>& visited_angles = fov.visited_angles;
 	AngleResult result = AngleResult::New;
 	size_t update_index = -1;
 	for (size_t i = 0; i < visited_angles.size(); i++) {
@@ -269,7 +464,7 @@ LightingSystem::AngleResult LightingSystem::try_add_angle(dvec2& angle)
 	return result;
 }
 
-vec2 LightingSystem::project_onto_tile(uvec2 tile, vec2 player_world_pos, double angle)
+vec2 LightingSystem::project_onto_tile(uvec2 tile, vec2 player_world_pos, double angle) const
 {
 	dvec2 dpos = glm::rotate(dvec2(1, 0), angle);
 	dvec2 sign = dvec2((dpos.x > 0) ? 1.f : -1.f, (dpos.y > 0) ? 1.f : -1.f);
@@ -314,8 +509,9 @@ vec2 LightingSystem::project_onto_tile(uvec2 tile, vec2 player_world_pos, double
 	return min_pos;
 }
 
-LightingSystem::AngleResult LightingSystem::check_visible(dvec2& angle) {
-	for (auto& pair : visited_angles) {
+LightingSystem::AngleResult LightingSystem::check_visible(const FieldOfView& fov, dvec2& angle) const
+{
+	for (const auto& pair : fov.visited_angles) {
 		if (rad_to_int(pair.x) <= rad_to_int(angle.x) && rad_to_int(pair.y) >= rad_to_int(angle.y)) {
 			return AngleResult::Redundant;
 		}
@@ -334,35 +530,25 @@ void LightingSystem::mark_as_visible(uvec2 tile)
 	visible_tiles.insert(tile);
 	uint8_t room_index = MapUtility::get_room_index(tile);
 	if (visible_rooms.count(room_index) == 0) {
-		visible_rooms.emplace(room_index, tile);
-		for (auto [entity, room, element] : registry.view<Room, BigRoomElement>().each()) {
-			if (room.room_index == room_index) {
-				Entity curr = registry.get<BigRoom>(element.big_room).first_room;
-				while (curr != entt::null) {
-					visible_rooms.emplace(registry.get<Room>(curr).room_index, tile);
-					curr = registry.get<BigRoomElement>(curr).next_room;
-				}
-			}
+		for (uint8_t member : map_generator->get_big_room_members(room_index)) {
+			visible_rooms.emplace(member, tile);
 		}
 	}
 }
 
 void LightingSystem::update_visible()
 {
-	for (auto [entity, room] : registry.view<Room>().each()) {
-		if (!room.visible && visible_rooms.count(room.room_index) > 0) {
-			uvec2 tile = visible_rooms.at(room.room_index);
-			if (BigRoomElement* element = registry.try_get<BigRoomElement>(entity)) {
-				Entity curr = registry.get<BigRoom>(element->big_room).first_room;
-				while (curr != entt::null) {
-
-					registry.get<Room>(curr).visible = true;
-					registry.emplace<RoomAnimation>(curr, tile);
-					curr = registry.get<BigRoomElement>(curr).next_room;
-				}
-			} else {
+	for (const auto& [room_index, tile] : visible_rooms) {
+		Entity entity = map_generator->get_room_entity(room_index);
+		if (entity == entt::null || registry.get<Room>(entity).visible) {
+			continue;
+		}
+		for (uint8_t member : map_generator->get_big_room_members(room_index)) {
+			Entity member_entity = map_generator->get_room_entity(member);
+			Room& room = registry.get<Room>(member_entity);
+			if (!room.visible) {
 				room.visible = true;
-				registry.emplace<RoomAnimation>(entity, tile);
+				registry.emplace<RoomAnimation>(member_entity, tile);
 			}
 		}
 	}
@@ -3,9 +3,13 @@
 #include "components.hpp"
 
 #include "map_generator_system.hpp"
+#include "thread_pool.hpp"
+#include "transient_pool.hpp"
 #include "tutorial_system.hpp"
+#include "visibility_table.hpp"
 
 #include <glm/gtx/hash.hpp>
+#include <limits>
 #include <unordered_set>
 
 // System responsible for setting up OpenGL and for rendering all the
@@ -16,8 +20,11 @@ class LightingSystem {
 	std::shared_ptr<TutorialSystem> tutorials;
 
 public:
-	explicit LightingSystem(std::shared_ptr<TutorialSystem> tutorials)
+	// Games running side by side on their own threads want fewer lighting workers, or none
+	explicit LightingSystem(std::shared_ptr<TutorialSystem> tutorials,
+							size_t worker_threads = ThreadPool::hardware_workers)
 		: tutorials(tutorials)
+		, pool(worker_threads)
 	{
 	}
 
@@ -26,7 +33,26 @@ public:
 
 	void step(float elapsed_ms);
 
-	bool is_visible(uvec2 tile);
+	bool is_visible(uvec2 tile) const;
+
+	// Whether `to` can be seen from `from`, answered from the level's visibility table when it is up to date,
+	// otherwise from the player's current field of view if `from` is where it was computed, or else from a field of
+	// view computed from `from` on the spot
+	bool is_visible_from(uvec2 from, uvec2 to) const;
+
+	// Change whenever a static or other light's LightMask changes, so the renderer knows to remake that kind's geometry
+	unsigned int get_static_mask_version() const { return static_mask_version; }
+	unsigned int get_dynamic_mask_version() const { return dynamic_mask_version; }
+
+	// The visibility table is precomputed per level as it first loads, and patched when doors open
+	void set_visibility_table_enabled(bool enabled) { use_visibility_table = enabled; }
+
+	// Runs the player's field of view from the given tile without touching the registry, used by the lighting benchmark
+	struct FieldOfViewStats {
+		size_t visible_tiles = 0;
+		size_t triangles = 0;
+	};
+	FieldOfViewStats compute_field_of_view(uvec2 origin_map_pos) const;
 
 private:
 	enum class AngleResult {
@@ -35,33 +61,78 @@ private:
 		New = 2,
 	};
 
-	void spin(uvec2 player_map_pos, vec2 player_world_pos);
-	void process_tile(vec2 player_world_pos, uvec2 tile);
+	// Working state for a single field of view computation
+	// Every light gets its own, which is what lets lights be processed concurrently
+	struct FieldOfView {
+		vec2 origin;
+		int radius;
+		// Only the player's field of view is turned into line of sight geometry
+		bool emit_geometry = false;
+
+		std::vector<dvec2> visited_angles;
+		// In the order they were reached, starting with the origin
+		std::vector<uvec2> visible_tiles;
+		std::vector<LightingTriangle> triangles;
+		std::vector<uvec2> lit_walls;
+	};
+
+	// Forgets everything cached by level index once the map's layouts have been replaced
+	void drop_stale_caches();
+	// Builds the current level's visibility table, or patches it if the occlusion changed since
+	void update_visibility_table();
+
+	// Computes the player's field of view along with every other light's mask
+	void spin_lights(Entity player, uvec2 player_map_pos, vec2 player_world_pos);
+
+	void spin(FieldOfView& fov, uvec2 origin_map_pos) const;
+	void process_tile(FieldOfView& fov, uvec2 tile) const;
 
 	// Wall case
-	AngleResult try_add_angle(dvec2& angle);
-	vec2 project_onto_tile(uvec2 tile, vec2 player_world_pos, double angle);
-	void draw_tile(AngleResult result, const dvec2& angle, uvec2 tile, vec2 player_world_pos);
+	AngleResult try_add_angle(FieldOfView& fov, dvec2& angle) const;
+	vec2 project_onto_tile(uvec2 tile, vec2 origin, double angle) const;
+	void draw_tile(FieldOfView& fov, AngleResult result, const dvec2& angle, uvec2 tile) const;
 
 	// Non-wall case
-	AngleResult check_visible(dvec2& angle);
+	AngleResult check_visible(const FieldOfView& fov, dvec2& angle) const;
+
+	// Line of sight geometry for the renderer
+	void light_tile(uvec2 pos);
+	void light_triangle(vec2 p1, vec2 p2, vec2 p3);
 
 	// Exploration / hidden monsters stuff
 	void mark_as_visible(uvec2 tile);
 	void update_visible();
 
-	inline int rad_to_int(double angle)
+	inline int rad_to_int(double angle) const
 	{
 		return static_cast<int>(round(angle * half_pseudo_degrees / glm::pi<double>()));
 	}
 
-	std::vector<dvec2> visited_angles;
 	std::unordered_set<uvec2> visible_tiles;
+	// Where the player stood when visible_tiles was computed
+	uvec2 visible_tiles_origin = { std::numeric_limits<uint>::max(), std::numeric_limits<uint>::max() };
 	std::unordered_map<uint8_t, uvec2> visible_rooms;
 	const int light_radius = MapUtility::map_size * MapUtility::room_size;
 	const double half_pseudo_degrees = 2 << 14;
 	const double tol = 4.0 / half_pseudo_degrees;
 
+	// Masks of static lights, by level and then light position, so revisiting a level doesn't recompute them
+	std::unordered_map<int, std::unordered_map<uvec2, LightMask>> static_light_masks;
+	unsigned int static_mask_version = 0;
+	unsigned int dynamic_mask_version = 0;
+
+	// Precomputed visibility for each level visited
+	std::unordered_map<int, VisibilityTable> visibility_tables;
+	// The map's layout generation the caches above were built from
+	unsigned int layout_generation = 0;
+	bool use_visibility_table = true;
+
+	ThreadPool pool;
+
+	// Line of sight geometry is remade every tick, so it recycles its entities
+	TransientPool<LightingTile> lit_wall_pool;
+	TransientPool<LightingTriangle> triangle_pool;
+
 	static constexpr float center_offset = MapUtility::tile_size / 2.f + .25f;
 	static constexpr std::array<ivec2, 4> offsets = {
 		ivec2(-1, -1),
@@ -6,10 +6,10 @@
 #include <rapidjson/istreamwrapper.h>
 #include <rapidjson/schema.h>
 
-void LootSystem::init(std::shared_ptr<std::default_random_engine> global_rng,
+void LootSystem::init(std::shared_ptr<std::default_random_engine> random_stream,
 					  std::shared_ptr<TutorialSystem> tutorial_system)
 {
-	this->rng = std::move(global_rng);
+	this->rng = std::move(random_stream);
 	this->tutorials = std::move(tutorial_system);
 	std::ifstream file = std::ifstream(json_schema_path("items_schema.json"));
 	rapidjson::IStreamWrapper schema_wrapper(file);
@@ -7,7 +7,7 @@
 
 class LootSystem {
 public:
-	void init(std::shared_ptr<std::default_random_engine> global_rng, std::shared_ptr<TutorialSystem> tutorial_system);
+	void init(std::shared_ptr<std::default_random_engine> random_stream, std::shared_ptr<TutorialSystem> tutorial_system);
 
 	void restart_game();
 
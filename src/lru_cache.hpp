@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Counters kept by LruCache, evictions include values replaced or cleared
+struct LruCacheStats {
+	size_t resident_bytes = 0;
+	size_t entries = 0;
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+};
+
+// Map that holds at most a byte budget's worth of values, dropping the least recently used ones to make room.
+// Every value is inserted with the number of bytes it accounts for, and the eviction callback gets a chance to free
+// whatever the value owns (e.g. a GL texture) before it is dropped.
+template <typename Key, typename Value, typename Hash = std::hash<Key>> class LruCache {
+public:
+	using EvictionCallback = std::function<void(const Key&, Value&)>;
+
+	explicit LruCache(size_t byte_budget, EvictionCallback on_evict = nullptr)
+		: byte_budget(byte_budget)
+		, on_evict(std::move(on_evict))
+	{
+	}
+	~LruCache() { clear(); }
+
+	LruCache(const LruCache&) = delete;
+	LruCache& operator=(const LruCache&) = delete;
+	LruCache(LruCache&&) = delete;
+	LruCache& operator=(LruCache&&) = delete;
+
+	void set_eviction_callback(EvictionCallback callback) { on_evict = std::move(callback); }
+
+	// Returns nullptr on a miss, a hit makes the value the most recently used
+	Value* find(const Key& key)
+	{
+		auto itr = lookup.find(key);
+		if (itr == lookup.end()) {
+			stats.misses++;
+			return nullptr;
+		}
+		stats.hits++;
+		entries.splice(entries.begin(), entries, itr->second);
+		return &itr->second->value;
+	}
+
+	// Inserts or replaces the value for key, then evicts until the cache fits its budget again
+	// The new value itself is never evicted, even if it alone is over budget
+	Value& insert(const Key& key, Value value, size_t bytes)
+	{
+		auto itr = lookup.find(key);
+		if (itr != lookup.end()) {
+			evict(itr->second);
+		}
+		entries.push_front({ key, std::move(value), bytes });
+		lookup.emplace(key, entries.begin());
+		stats.resident_bytes += bytes;
+		stats.entries++;
+		trim(byte_budget);
+		return entries.front().value;
+	}
+
+	void set_byte_budget(size_t budget)
+	{
+		byte_budget = budget;
+		trim(byte_budget);
+	}
+	size_t get_byte_budget() const { return byte_budget; }
+
+	// Evicts everything, calling the eviction callback for each value
+	void clear()
+	{
+		while (!entries.empty()) {
+			evict(std::prev(entries.end()));
+		}
+	}
+
+	const LruCacheStats& get_stats() const { return stats; }
+
+private:
+	struct Entry {
+		Key key;
+		Value value;
+		size_t bytes;
+	};
+	using EntryItr = typename std::list<Entry>::iterator;
+
+	void evict(EntryItr entry)
+	{
+		if (on_evict) {
+			on_evict(entry->key, entry->value);
+		}
+		stats.resident_bytes -= entry->bytes;
+		stats.entries--;
+		stats.evictions++;
+		lookup.erase(entry->key);
+		entries.erase(entry);
+	}
+
+	// Drops least recently used entries, always keeping the most recent one
+	void trim(size_t budget)
+	{
+		while (stats.resident_bytes > budget && entries.size() > 1) {
+			evict(std::prev(entries.end()));
+		}
+	}
+
+	size_t byte_budget;
+	EvictionCallback on_evict;
+	// Most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<Key, EntryItr, Hash> lookup;
+	LruCacheStats stats;
+};
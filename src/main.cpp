@@ -4,18 +4,24 @@
 
 // stlib
 #include <chrono>
+#include <cstdlib>
+#include <string>
 
 // internal
 #include "ai_system.hpp"
 #include "animation_system.hpp"
 #include "combat_system.hpp"
+#include "input_log.hpp"
 #include "lighting_system.hpp"
 #include "loot_system.hpp"
 #include "map_generator_system.hpp"
 #include "music_system.hpp"
 #include "physics_system.hpp"
+#include "profiler.hpp"
+#include "random_streams.hpp"
 #include "render_system.hpp"
 #include "story_system.hpp"
+#include "system_timings.hpp"
 #include "turn_system.hpp"
 #include "tutorial_system.hpp"
 #include "ui_system.hpp"
@@ -24,15 +30,56 @@
 
 using Clock = std::chrono::high_resolution_clock;
 
+// Longest frame that is simulated in full
+static constexpr float max_frame_ms = 250.f;
+// Frame rate cap while anything is animating, 0 leaves it to vsync
+static constexpr float max_fps = 0.f;
+// Frame rate while idle, looping sprite animations change slower than this
+static constexpr float idle_fps = 15.f;
+
 // Entry point
-int main()
+// Options: --seed <n> plays from the given seed, --record <file> saves every input of the session with its seed,
+// --replay <file> plays a recording back as fast as frames can be drawn, then prints the time spent in each system
+// and a hash of the final state, --trace <file> saves the last of the profiler's timings as a Chrome trace on exit in
+// builds with the profiler
+int main(int argc, char* argv[])
 {
+	uint64_t seed = RandomStreams::make_seed();
+	const char* record_path = nullptr;
+	const char* replay_path = nullptr;
+	const char* trace_path = nullptr;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string option = argv[i];
+		if (option == "--seed") {
+			seed = std::strtoull(argv[i + 1], nullptr, 10);
+		} else if (option == "--record") {
+			record_path = argv[i + 1];
+		} else if (option == "--replay") {
+			replay_path = argv[i + 1];
+		} else if (option == "--trace") {
+			trace_path = argv[i + 1];
+		} else {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	InputLog replay;
+	if (replay_path != nullptr) {
+		if (!replay.load(replay_path)) {
+			return EXIT_FAILURE;
+		}
+		seed = replay.get_seed();
+	}
+
 	// Audio core
 	std::shared_ptr<SoLoud::Soloud> so_loud = std::make_shared<SoLoud::Soloud>();
 	so_loud->init();
 
 	Debug debugging;
 
+	// Random streams for every system, from a fresh seed each run unless one was given
+	std::shared_ptr<RandomStreams> random = std::make_shared<RandomStreams>(seed);
+
 	// Music System
 	std::shared_ptr<MusicSystem> music = std::make_shared<MusicSystem>(so_loud);
 
@@ -61,11 +108,11 @@ int main()
 	std::shared_ptr<StorySystem> stories = std::make_shared<StorySystem>(animations, map, music);
 
 	// Global systems
-	WorldSystem world(debugging, animations, combat, loot, map, music, stories, turns, tutorials, ui, so_loud);
+	WorldSystem world(debugging, animations, combat, loot, map, music, stories, turns, tutorials, ui, so_loud, random);
 	LightingSystem lighting(tutorials);
 	RenderSystem renderer(debugging, lighting);
 	PhysicsSystem physics(debugging, map);
-	AISystem ai(debugging, animations, combat, lighting, map, turns, so_loud);
+	AISystem ai(debugging, animations, combat, lighting, map, turns, so_loud, *random);
 
 	// Initializing window
 	GLFWwindow* window = world.create_window(window_width_px, window_height_px);
@@ -81,28 +128,97 @@ int main()
 	world.init(&renderer);
 	lighting.init(map);
 
-	// variable timestep loop
+	InputLog recording(seed);
+	if (record_path != nullptr) {
+		world.record_input(&recording);
+	}
+	bool replaying = replay_path != nullptr;
+	if (replaying) {
+		// The recording is the only input, and frames go out as fast as they are drawn
+		world.set_window_input(false);
+		glfwSwapInterval(0);
+	}
+	size_t next_input = 0;
+	SystemTimings timings;
+	using System = SystemTimings::System;
+
+	// Fixed timestep loop, the simulation advances in equal ticks and frames are drawn between them
+	float accumulated_ms = 0;
 	auto t = Clock::now();
 	while (!world.is_over()) {
-		// Processes system messages, if this wasn't present the window would become
-		// unresponsive
-		glfwPollEvents();
-
-		// Calculating elapsed times in milliseconds from the previous iteration
-		auto now = Clock::now();
-		float elapsed_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
-		t = now;
-
-		world.step(elapsed_ms);
-		ai.step(elapsed_ms);
-		physics.step(elapsed_ms, window_width_px, window_height_px);
-		world.handle_collisions();
-		animations->update_animations(elapsed_ms, turns->get_inactive_color());
-		map->step(elapsed_ms);
-		turns->step();
-		music->step(elapsed_ms);
-		lighting.step(elapsed_ms);
-		renderer.draw();
+		if (replaying) {
+			glfwPollEvents();
+			if (world.get_tick() >= replay.get_end_tick()) {
+				break;
+			}
+			// One tick per frame, however long it took
+			accumulated_ms = tick_ms;
+		} else {
+			// Nothing needs redrawing at the full rate while waiting on the player, so sleep until the next frame is
+			// due
+			// Input wakes us straight away, so the game still responds immediately
+			bool idle = animations->is_idle() && !stories->in_cutscene();
+			float frame_ms = idle ? 1000.f / idle_fps : ((max_fps > 0) ? 1000.f / max_fps : 0.f);
+			float waited_ms
+				= (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t)).count() / 1000;
+			if (waited_ms < frame_ms) {
+				glfwWaitEventsTimeout((frame_ms - waited_ms) / 1000.0);
+			} else {
+				// Processes system messages, if this wasn't present the window would become
+				// unresponsive
+				glfwPollEvents();
+			}
+
+			// Calculating elapsed times in milliseconds from the previous iteration
+			auto now = Clock::now();
+			float elapsed_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
+			t = now;
+			// After a stall, e.g. the window being dragged, skip ahead rather than simulating all of it
+			accumulated_ms += min(elapsed_ms, max_frame_ms);
+		}
+
+		while (accumulated_ms >= tick_ms) {
+			const std::vector<InputEvent>& inputs = replay.get_events();
+			for (; next_input < inputs.size() && inputs.at(next_input).tick <= world.get_tick(); next_input++) {
+				world.send_input(inputs.at(next_input));
+			}
+
+			PROFILE_SCOPE("tick");
+			timings.time(System::World, [&]() { world.step(tick_ms); });
+			timings.time(System::AI, [&]() { ai.step(tick_ms); });
+			timings.time(System::Physics, [&]() { physics.step(tick_ms, window_width_px, window_height_px); });
+			timings.time(System::Collisions, [&]() { world.handle_collisions(); });
+			timings.time(System::Animations,
+						 [&]() { animations->update_animations(tick_ms, turns->get_inactive_color()); });
+			timings.time(System::Map, [&]() { map->step(tick_ms); });
+			timings.time(System::Turns, [&]() { turns->step(); });
+			timings.time(System::Music, [&]() { music->step(tick_ms); });
+			// Part of the tick rather than the frame, what is lit and explored feeds back into the game and replays must match
+			timings.time(System::Lighting, [&]() { lighting.step(tick_ms); });
+			accumulated_ms -= tick_ms;
+		}
+
+		renderer.set_interpolation(accumulated_ms / tick_ms);
+		timings.time(System::Render, [&]() { renderer.draw(); });
+	}
+
+	if (record_path != nullptr) {
+		recording.set_end_tick(world.get_tick());
+		recording.save(record_path);
+	}
+	if (replaying) {
+		printf("Replayed %llu ticks from seed %llu\n",
+			   static_cast<unsigned long long>(world.get_tick()),
+			   static_cast<unsigned long long>(seed));
+		timings.print(world.get_tick());
+		printf("State hash %016llx\n", static_cast<unsigned long long>(world.hash_state()));
+	}
+	if (trace_path != nullptr) {
+#ifdef ENABLE_PROFILER
+		Profiler::current().write_chrome_trace(trace_path);
+#else
+		fprintf(stderr, "Built without the profiler, configure with ENABLE_PROFILER to write %s\n", trace_path);
+#endif
 	}
 
 	return EXIT_SUCCESS;
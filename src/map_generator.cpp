@@ -2,6 +2,7 @@
 #include "components.hpp"
 
 #include <algorithm>
+#include <mutex>
 #include <set>
 #include <sstream>
 
@@ -15,13 +16,14 @@ using namespace MapUtility;
 static std::array<rapidjson::Document, (size_t)EnemyType::EnemyCount - 1> enemy_templates;
 
 static const int num_bosses = enemy_type_bosses.size();
-static bool enemy_templates_loaded = false;
+// Loaded once for the whole process, games on other threads may ask at the same time
+static std::once_flag enemy_templates_loaded;
 
 // room templates
 static const size_t num_room_templates = 4;
 static std::array<rapidjson::Document, num_room_templates> template_room_snapshot;
 static std::array<RoomLayout, num_room_templates> template_room_layout;
-static bool room_templates_loaded = false;
+static std::once_flag room_templates_loaded;
 
 static std::string enemy_template_path(const std::string& name)
 {
@@ -81,15 +83,12 @@ static void load_room_templates()
 			template_room_layout.at(i).at(tile_index) = json_doc["room_layout"][tile_index].GetUint();
 		}
 	}
-	room_templates_loaded = true;
 }
 
 RoomLayout MapGenerator::get_template_room_layout(MapGenerator::RoomType room_type)
 {
 	assert(static_cast<uint8_t>(room_type) >= static_cast<uint8_t>(RoomType::Entrance));
-	if (!room_templates_loaded) {
-		load_room_templates();
-	}
+	std::call_once(room_templates_loaded, load_room_templates);
 
 	return template_room_layout.at(static_cast<uint8_t>(room_type) - static_cast<uint8_t>(RoomType::Entrance));
 }
@@ -97,10 +96,7 @@ RoomLayout MapGenerator::get_template_room_layout(MapGenerator::RoomType room_ty
 static void
 add_enemy_to_level_snapshot(rapidjson::Document& level_snap_shot, ColorState team, int enemy_index, uvec2 map_pos)
 {
-	if (!enemy_templates_loaded) {
-		load_enemies_from_file();
-		enemy_templates_loaded = true;
-	}
+	std::call_once(enemy_templates_loaded, load_enemies_from_file);
 
 	if (!level_snap_shot.HasMember("enemies")) {
 		rapidjson::Value enemy_array(rapidjson::kArrayType);
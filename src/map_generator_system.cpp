@@ -1,4 +1,5 @@
 #include "map_generator_system.hpp"
+#include "profiler.hpp"
 #include "turn_system.hpp"
 #include "ui_system.hpp"
 
@@ -271,16 +272,84 @@ const std::vector<MapUtility::RoomLayout>& MapGeneratorSystem::get_level_room_la
 
 const MapLayout& MapGeneratorSystem::current_map() const { return get_level_layout(current_level); }
 
+unsigned int MapGeneratorSystem::get_occlusion_version() const
+{
+	return level_configurations.at(current_level).occlusion_version;
+}
+
+unsigned int MapGeneratorSystem::get_tile_version() const { return level_configurations.at(current_level).tile_version; }
+
 const std::set<MapUtility::RoomID>& MapGeneratorSystem::get_room_at_position(uvec2 pos) const
 {
-	RoomID room_index = current_map().at(pos.y / room_size).at(pos.x / room_size);
-	for (int i = 0; i < level_configurations.at(current_level).big_rooms.size(); i ++) {
-		const std::set<RoomID> & connected_rooms = level_configurations.at(current_level).big_rooms.at(i);
-		if (connected_rooms.find(room_index) != connected_rooms.end()) {
-			return connected_rooms;
+	uint8_t room_index = static_cast<uint8_t>((pos.y / room_size) * map_size + pos.x / room_size);
+	return room_groups.room_ids.at(room_groups.group_of.at(room_index));
+}
+
+const std::vector<uint8_t>& MapGeneratorSystem::get_big_room_members(uint8_t room_index) const
+{
+	return room_groups.members.at(room_groups.group_of.at(room_index));
+}
+
+void MapGeneratorSystem::build_room_groups(int level)
+{
+	constexpr uint8_t no_group = 0xff;
+	room_groups.group_of.fill(no_group);
+	room_groups.room_entities.fill(entt::null);
+	room_groups.members.clear();
+	room_groups.room_ids.clear();
+
+	const MapLayout& layout = get_level_layout(level);
+	auto add_to_group = [&](uint8_t room_index, uint8_t group) {
+		room_groups.group_of.at(room_index) = group;
+		room_groups.members.at(group).push_back(room_index);
+		room_groups.room_ids.at(group).emplace(layout.at(room_index / map_size).at(room_index % map_size));
+	};
+	auto new_group = [&]() {
+		room_groups.members.emplace_back();
+		room_groups.room_ids.emplace_back();
+		return static_cast<uint8_t>(room_groups.members.size() - 1);
+	};
+
+	// Big rooms from generation are stored as room ids
+	for (const std::set<RoomID>& big_room : level_configurations.at(level).big_rooms) {
+		uint8_t group = no_group;
+		for (uint8_t room_index = 0; room_index < map_size * map_size; room_index++) {
+			if (room_groups.group_of.at(room_index) == no_group
+				&& big_room.count(layout.at(room_index / map_size).at(room_index % map_size)) > 0) {
+				if (group == no_group) {
+					group = new_group();
+				}
+				add_to_group(room_index, group);
+			}
+		}
+	}
+
+	for (auto [entity, room] : registry.view<Room>().each()) {
+		room_groups.room_entities.at(room.room_index) = entity;
+	}
+
+	// Big rooms restored from a snapshot are linked lists of room entities
+	for (auto [entity, big_room] : registry.view<BigRoom>().each()) {
+		uint8_t group = no_group;
+		for (Entity curr = big_room.first_room; curr != entt::null; curr = registry.get<BigRoomElement>(curr).next_room) {
+			group = std::min(group, room_groups.group_of.at(registry.get<Room>(curr).room_index));
+		}
+		if (group == no_group) {
+			group = new_group();
+		}
+		for (Entity curr = big_room.first_room; curr != entt::null; curr = registry.get<BigRoomElement>(curr).next_room) {
+			uint8_t room_index = registry.get<Room>(curr).room_index;
+			if (room_groups.group_of.at(room_index) == no_group) {
+				add_to_group(room_index, group);
+			}
+		}
+	}
+
+	for (uint8_t room_index = 0; room_index < map_size * map_size; room_index++) {
+		if (room_groups.group_of.at(room_index) == no_group) {
+			add_to_group(room_index, new_group());
 		}
 	}
-	return std::set<RoomID>({room_index});
 }
 
 bool MapGeneratorSystem::is_on_map(uvec2 pos) const
@@ -294,11 +363,7 @@ bool MapGeneratorSystem::walkable(uvec2 pos) const
 		return false;
 	}
 
-	TileID tile_id = get_tile_id_from_map_pos(pos);
-
-	return (is_floor_tile(tile_id) || is_trap_tile(tile_id) || is_next_level_tile(tile_id)
-			|| is_last_level_tile(tile_id) || is_grass_tile(tile_id) || (tile_id == 63 && is_door_tile(tile_id))
-			|| (tile_id == 59));
+	return is_walkable_tile(get_tile_id_from_map_pos(pos));
 }
 
 bool MapGeneratorSystem::walkable_and_free(Entity entity, uvec2 pos, bool check_active_color) const
@@ -363,6 +428,7 @@ MapGeneratorSystem::shortest_path(Entity entity, uvec2 start_pos, uvec2 target,
 	if (!use_a_star) {
 		return bfs(entity, start_pos, target);
 	}
+	PROFILE_SCOPE("a*");
 	std::unordered_map<uvec2, uvec2> parent;
 	std::unordered_map<uvec2, float> min_score;
 	std::unordered_set<uvec2> visited;
@@ -540,6 +606,7 @@ void MapGeneratorSystem::load_level(int level)
 {
 	// Load the new map
 	create_map(level);
+	create_static_lights(level);
 	// Read from snapshots first, if not exists, read from pre-configured file
 	const std::string& snapshot = get_level_snap_shot(level);
 	assert(!snapshot.empty());
@@ -576,6 +643,8 @@ void MapGeneratorSystem::load_level(int level)
 		}
 	}
 
+	build_room_groups(level);
+
 	// Visited rooms
 	if (json_doc.HasMember("visited_rooms") && json_doc["visited_rooms"].IsArray()) {
 		const rapidjson::Value& visited_rooms = json_doc["visited_rooms"];
@@ -637,6 +706,15 @@ void MapGeneratorSystem::load_level(int level)
 		}
 		registry.get<RenderRequest>(help_picture).visible = true;
 	}
+
+	for (const auto& level_load_callback : level_load_callbacks) {
+		level_load_callback(level);
+	}
+}
+
+void MapGeneratorSystem::on_level_load(const std::function<void(int level)>& level_load_callback)
+{
+	level_load_callbacks.push_back(level_load_callback);
 }
 
 void MapGeneratorSystem::clear_level()
@@ -646,6 +724,8 @@ void MapGeneratorSystem::clear_level()
 	registry.destroy(room_view.begin(), room_view.end());
 	auto big_room_view = registry.view<BigRoom>();
 	registry.destroy(big_room_view.begin(), big_room_view.end());
+	auto static_light_view = registry.view<StaticLight>();
+	registry.destroy(static_light_view.begin(), static_light_view.end());
 
 	// Clear the enemies
 	auto enemy_view = registry.view<Enemy>();
@@ -701,8 +781,9 @@ void MapGeneratorSystem::load_initial_level()
 		level_configurations.clear();
 		init();
 	}
-	load_level(0);
+	layout_generation++;
 	current_level = 0;
+	load_level(0);
 }
 
 // Creates a room entity, with room type referencing to the predefined room
@@ -739,6 +820,35 @@ void MapGeneratorSystem::create_map(int level) const
 	}
 }
 
+void MapGeneratorSystem::create_static_lights(int level) const
+{
+	static constexpr vec3 torch_color = { 1.f, .75f, .45f };
+	static constexpr vec3 fire_color = { 1.f, .5f, .25f };
+
+	const MapLayout& mapping = get_level_layout(level);
+	for (uint map_row = 0; map_row < map_size; map_row++) {
+		for (uint map_col = 0; map_col < map_size; map_col++) {
+			RoomID room_id = mapping.at(map_row).at(map_col);
+			for (uint8_t row = 0; row < room_size; row++) {
+				for (uint8_t col = 0; col < room_size; col++) {
+					TileID tile_id = get_tile_id_from_room(level, room_id, row, col);
+					bool torch = is_torch_tile(tile_id);
+					if (!torch && !is_fire_tile(tile_id)) {
+						continue;
+					}
+					Entity entity = registry.create();
+					registry.emplace<MapPosition>(entity, uvec2(map_col * room_size + col, map_row * room_size + row));
+					registry.emplace<Light>(entity, ((torch) ? 3.f : 2.f) * tile_size);
+					registry.emplace<Color>(entity, (torch) ? torch_color : fire_color);
+					registry.emplace<StaticLight>(entity);
+					// Keep the light from blocking movement or being targeted
+					registry.emplace<Environmental>(entity);
+				}
+			}
+		}
+	}
+}
+
 const RoomLayout& MapGeneratorSystem::get_room_layout(int level, MapUtility::RoomID room_id) const
 {
 	return get_level_room_layouts(level).at(static_cast<size_t>(room_id));
@@ -913,8 +1023,15 @@ void MapGeneratorSystem::step(float elapsed_ms)
 				animated_tile_iter.second.frame
 					= ((animated_tile_iter.second.frame) + 1) % animated_tile_iter.second.max_frames;
 
-				level_conf.room_layouts.at(room_index).at(animated_tile_iter.first)
-					= animated_tile_iter.second.tile_id + animated_tile_iter.second.frame;
+				uint32_t& layout_tile = level_conf.room_layouts.at(room_index).at(animated_tile_iter.first);
+				TileID next_tile = animated_tile_iter.second.tile_id + animated_tile_iter.second.frame;
+				if (is_opaque_tile(static_cast<TileID>(layout_tile)) != is_opaque_tile(next_tile)) {
+					level_conf.occlusion_version++;
+				}
+				if (layout_tile != next_tile) {
+					level_conf.tile_version++;
+				}
+				layout_tile = next_tile;
 				if (animated_tile_iter.second.is_trigger && animated_tile_iter.second.frame == 0) {
 					animated_tile_iter.second.activated = false;
 				}
@@ -982,6 +1099,7 @@ void MapGeneratorSystem::stop_editing_level()
 	clear_level();
 	level_configurations = level_configurations_backup;
 	current_level = current_level_backup;
+	layout_generation++;
 	load_level(current_level);
 }
 void MapGeneratorSystem::edit_next_level()
@@ -996,6 +1114,8 @@ void MapGeneratorSystem::edit_next_level()
 		level_configurations.insert(
 			level_configurations.end() - 1,
 			MapGenerator::generate_level(level_generation_confs.at(current_level - num_predefined_levels), true));
+		// The final level moved up an index
+		layout_generation++;
 	}
 	load_level(current_level);
 }
@@ -1032,8 +1152,14 @@ void MapGeneratorSystem::save_level_generation_confs()
 void MapGeneratorSystem::regenerate_map()
 {
 	clear_level();
+	unsigned int occlusion_version = level_configurations.at(current_level).occlusion_version;
+	unsigned int tile_version = level_configurations.at(current_level).tile_version;
 	level_configurations.at(current_level)
 		= MapGenerator::generate_level(level_generation_confs.at(current_level - num_predefined_levels), true);
+	// The layout changed wholesale, so nothing computed from the old one can be reused
+	level_configurations.at(current_level).occlusion_version = occlusion_version + 1;
+	level_configurations.at(current_level).tile_version = tile_version + 1;
+	layout_generation++;
 	load_level(current_level);
 }
 void MapGeneratorSystem::increment_seed()
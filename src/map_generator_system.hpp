@@ -10,6 +10,7 @@ class TurnSystem;
 class UISystem;
 
 #include <array>
+#include <functional>
 #include <set>
 
 #include "soloud_wav.h"
@@ -100,6 +101,22 @@ private:
 	void create_map(int level) const;
 	// Create a room
 	void create_room(vec2 position, MapUtility::RoomID room_id, int level, uint index) const;
+	// Create a light for every torch and fire tile in the level
+	void create_static_lights(int level) const;
+
+	// Rooms of the current level grouped by the big room they belong to, rebuilt whenever a level loads,
+	// rooms that aren't part of a big room get a group to themselves
+	struct RoomGroups {
+		// Group of each room, by room index
+		std::array<uint8_t, MapUtility::map_size * MapUtility::map_size> group_of = {};
+		// Room entity at each room index
+		std::array<Entity, MapUtility::map_size * MapUtility::map_size> room_entities = {};
+		// Room indices and room ids in each group
+		std::vector<std::vector<uint8_t>> members;
+		std::vector<std::set<MapUtility::RoomID>> room_ids;
+	};
+	RoomGroups room_groups;
+	void build_room_groups(int level);
 
 	// Entity for the help picture
 	Entity help_picture = entt::null;
@@ -110,6 +127,12 @@ private:
 	std::vector<MapUtility::LevelConfiguration> level_configurations_backup;
 	int current_level_backup = 0;
 
+	// Incremented whenever level configurations are replaced rather than edited in place
+	unsigned int layout_generation = 0;
+
+	// Observer Pattern: callbacks of load_level()
+	std::vector<std::function<void(int level)>> level_load_callbacks;
+
 	// buffer to save rooms that need to be animated, room is removed from the buffer once all animations are completed
 	std::set<MapUtility::RoomID> animated_room_buffer;
 
@@ -133,9 +156,36 @@ public:
 	// Get the current level mapping
 	const MapUtility::MapLayout& current_map() const;
 
+	int get_current_level() const { return current_level; }
+
+	// Number of levels, including the predefined ones
+	int get_level_count() const { return static_cast<int>(level_configurations.size()); }
+
+	// Makes a level current without creating any of its entities, for tools that only need its layout
+	void set_current_level(int level) { current_level = level; }
+
+	// Changes whenever a tile on the current level starts or stops blocking light
+	unsigned int get_occlusion_version() const;
+
+	// Changes whenever any tile id on the current level changes
+	unsigned int get_tile_version() const;
+
+	// Changes whenever the levels' layouts are replaced wholesale, e.g. restarting, regenerating a level or leaving the
+	// map editor, after which a level index and version no longer tell a layout apart from the one before
+	unsigned int get_layout_generation() const { return layout_generation; }
+
+	// Observer Pattern: attach a callback called once a level has loaded and become the current level
+	void on_level_load(const std::function<void(int level)>& level_load_callback);
+
 	// Get current room the player is in, return a list of rooms as big room is considered as a room
 	const std::set<MapUtility::RoomID>& get_room_at_position(uvec2 pos) const;
 
+	// Room indices of every room in the same big room as the given one, including itself
+	const std::vector<uint8_t>& get_big_room_members(uint8_t room_index) const;
+
+	// Room entity at the given room index of the current level
+	Entity get_room_entity(uint8_t room_index) const { return room_groups.room_entities.at(room_index); }
+
 	// Check if a position is within the bounds of the current level
 	bool is_on_map(uvec2 pos) const;
 
@@ -115,3 +115,15 @@ bool MapUtility::is_wall_tile(TileID tile_id)
 
 	return blocking_tiles.find(tile_id) != blocking_tiles.end();
 }
+
+bool MapUtility::is_walkable_tile(TileID tile_id)
+{
+	return (is_floor_tile(tile_id) || is_trap_tile(tile_id) || is_next_level_tile(tile_id)
+			|| is_last_level_tile(tile_id) || is_grass_tile(tile_id) || (tile_id == 63 && is_door_tile(tile_id))
+			|| (tile_id == 59));
+}
+
+bool MapUtility::is_opaque_tile(TileID tile_id)
+{
+	return !is_walkable_tile(tile_id) && !is_torch_tile(tile_id) && !is_any_chest_tile(tile_id);
+}
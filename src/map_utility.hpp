@@ -38,6 +38,10 @@ inline bool is_spike_tile(TileID tile_id) { return 28 <= tile_id && tile_id < 32
 inline bool is_fire_tile(TileID tile_id) { return 36 <= tile_id && tile_id < 40; }
 
 bool is_wall_tile(TileID tile_id);
+// Whether a tile can be stood on, ignoring anything currently occupying it
+bool is_walkable_tile(TileID tile_id);
+// Whether a tile blocks light and line of sight
+bool is_opaque_tile(TileID tile_id);
 
 // 10*10 grid used to represent map layout
 using MapLayout = std::array<std::array<MapUtility::RoomID, MapUtility::room_size>, MapUtility::room_size>;
@@ -79,6 +83,12 @@ struct LevelConfiguration {
 
 	// big rooms in current level
 	std::vector<std::set<RoomID>> big_rooms;
+
+	// incremented whenever a tile changes between opaque and see-through, e.g. a door opening,
+	// so anything cached from the level's occlusion knows to recompute
+	unsigned int occlusion_version = 0;
+	// incremented whenever any tile id in room_layouts changes, so the renderer knows to re-upload the level's tiles
+	unsigned int tile_version = 0;
 };
 
 // Per-Level generation configuation, used as the metadata for generating a level,
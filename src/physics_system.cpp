@@ -25,6 +25,7 @@ void PhysicsSystem::step(float elapsed_ms, float /*window_width*/, float /*windo
 	// Currently still using motion component to udpate projectile position based on velocity
 	// TODO: Change check for motions into check for projectiles, update based on projectile component
 	for (auto [entity, velocity, position]: registry.view<Velocity, WorldPosition>().each()) {
+		registry.emplace_or_replace<PreviousWorldPosition>(entity, position.position);
 		float step_seconds = 1.0f * (elapsed_ms / 1000.f);
 		position.position += velocity.get_velocity() * step_seconds;
 	}
@@ -34,42 +35,60 @@ void PhysicsSystem::step(float elapsed_ms, float /*window_width*/, float /*windo
 	// player and enemy collisions don't need to be considered because
 	// their movements are tile-based, projectiles are the only exception.
 	for (auto [entity_i, projectile, world_pos] : registry.view<ActiveProjectile, WorldPosition>().each()) {
-
-		if (debugging.in_debug_mode) {
-			create_line(world_pos.position, projectile.radius * 2.f, 0);
-			create_line(world_pos.position, projectile.radius * 2.f, glm::pi<float>() / 2.f);
+		check_projectile_collisions(entity_i, projectile, world_pos.position);
+		if (turbo) {
+			// Steps no longer than the collider's radius can't pass over a tile
+			// Nothing flies further than across the whole map, so a projectile still going by then hits nothing
+			vec2 sweep_step = registry.get<Velocity>(entity_i).get_direction() * projectile.radius;
+			float max_distance = MapUtility::tile_size * MapUtility::room_size * MapUtility::map_size * 2.f;
+			for (float distance = 0; !registry.all_of<Collision>(entity_i); distance += projectile.radius) {
+				if (distance > max_distance) {
+					registry.emplace<Collision>(entity_i, entt::null);
+					break;
+				}
+				world_pos.position += sweep_step;
+				check_projectile_collisions(entity_i, projectile, world_pos.position);
+			}
 		}
+	}
+}
 
-		Geometry::Circle collider = { world_pos.position, projectile.radius };
-		std::vector<uvec2> tiles
-			= MapUtility::get_surrounding_tiles(MapUtility::world_position_to_map_position(collider.center),
-												(int)floor(1 + projectile.radius * 2.f / MapUtility::tile_size));
+void PhysicsSystem::check_projectile_collisions(Entity entity, const ActiveProjectile& projectile, vec2 position)
+{
+	if (debugging.in_debug_mode) {
+		create_line(position, projectile.radius * 2.f, 0);
+		create_line(position, projectile.radius * 2.f, glm::pi<float>() / 2.f);
+	}
 
-		tiles.erase(std::remove_if(tiles.begin(),
-								   tiles.end(),
-								   [&collider](const uvec2& tile) {
-									   vec2 center = MapUtility::map_position_to_world_position(tile);
-									   vec2 size = get_bounding_box();
-									   return !Geometry::Rectangle(center, size).intersects(collider);
-								   }),
-					tiles.end());
+	Geometry::Circle collider = { position, projectile.radius };
+	std::vector<uvec2> tiles
+		= MapUtility::get_surrounding_tiles(MapUtility::world_position_to_map_position(collider.center),
+											(int)floor(1 + projectile.radius * 2.f / MapUtility::tile_size));
 
-		// Check if the map position is occupied
-		Entity player
-			= registry.view<Player>().front();
-		PlayerInactivePerception& player_perception = registry.get<PlayerInactivePerception>(player);
-		ColorState& inactive_color = player_perception.inactive;
-		if (inactive_color == ColorState::Red) {
-			check_occupied<RedExclusive>(tiles, entity_i, projectile.shooter);
-		} else {
-			check_occupied<BlueExclusive>(tiles, entity_i, projectile.shooter);
-		}
-		for (uvec2 tile : tiles) {
-			// Check if projectile hits a wall
-			if (map_generator->is_wall(tile) || !map_generator->is_on_map(tile)) {
-				if (registry.try_get<Collision>(entity_i) == nullptr) {
-					registry.emplace<Collision>(entity_i, entt::null);
-				}
+	tiles.erase(std::remove_if(tiles.begin(),
+							   tiles.end(),
+							   [&collider](const uvec2& tile) {
+								   vec2 center = MapUtility::map_position_to_world_position(tile);
+								   vec2 size = get_bounding_box();
+								   return !Geometry::Rectangle(center, size).intersects(collider);
+							   }),
+				tiles.end());
+
+	// Check if the map position is occupied
+	Entity player
+		= registry.view<Player>().front();
+	PlayerInactivePerception& player_perception = registry.get<PlayerInactivePerception>(player);
+	ColorState& inactive_color = player_perception.inactive;
+	if (inactive_color == ColorState::Red) {
+		check_occupied<RedExclusive>(tiles, entity, projectile.shooter);
+	} else {
+		check_occupied<BlueExclusive>(tiles, entity, projectile.shooter);
+	}
+	for (uvec2 tile : tiles) {
+		// Check if projectile hits a wall
+		if (map_generator->is_wall(tile) || !map_generator->is_on_map(tile)) {
+			if (registry.try_get<Collision>(entity) == nullptr) {
+				registry.emplace<Collision>(entity, entt::null);
 			}
 		}
 	}
@@ -11,12 +11,20 @@ public:
 
 	void step(float elapsed_ms, float /*window_width*/, float /*window_height*/);
 
+	// In turbo mode projectiles don't fly, each one is swept along its path and hits whatever it would have
+	// hit on the step it's fired
+	void set_turbo(bool enabled) { turbo = enabled; }
+
 private:
+	// Adds a collision for the projectile if it overlaps an entity or a wall at the given position
+	void check_projectile_collisions(Entity entity, const ActiveProjectile& projectile, vec2 position);
+
 	template <typename ColorExclusive>
 	void check_occupied(const std::vector<uvec2>& tiles, Entity entity, Entity shooter);
 
 	const Debug& debugging;
 	const std::shared_ptr<MapGeneratorSystem> map_generator;
+	bool turbo = false;
 };
 
 template <typename ColorExclusive>
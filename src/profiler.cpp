@@ -0,0 +1,122 @@
+#include "profiler.hpp"
+
+#ifdef ENABLE_PROFILER
+
+// stlib
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace {
+thread_local Profiler* redirected = nullptr;
+
+// Small, stable ids for the trace's thread lanes
+uint32_t thread_index()
+{
+	static std::atomic<uint32_t> next_index(0);
+	thread_local uint32_t index = next_index++;
+	return index;
+}
+
+double percentile_ms(std::vector<int64_t>& durations_ns, double fraction)
+{
+	auto nth = durations_ns.begin() + static_cast<ptrdiff_t>(fraction * static_cast<double>(durations_ns.size() - 1));
+	std::nth_element(durations_ns.begin(), nth, durations_ns.end());
+	return static_cast<double>(*nth) / 1e6;
+}
+} // namespace
+
+Profiler::Redirect::Redirect(Profiler* target)
+	: previous(redirected)
+{
+	redirected = target;
+}
+
+Profiler::Redirect::~Redirect() { redirected = previous; }
+
+Profiler& Profiler::current()
+{
+	thread_local Profiler profiler;
+	return (redirected != nullptr) ? *redirected : profiler;
+}
+
+void Profiler::record(const char* name, Clock::time_point start, Clock::time_point end)
+{
+	int64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	uint32_t thread = thread_index();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+	Event event = { name, thread, start_ns, duration_ns };
+	if (events.size() < capacity) {
+		events.push_back(event);
+	} else {
+		events.at(next_event) = event;
+	}
+	next_event = (next_event + 1) % capacity;
+
+	auto section = std::find_if(sections.begin(), sections.end(), [&](const Section& s) { return s.name == name; });
+	if (section == sections.end()) {
+		section = sections.insert(sections.end(), Section { name, {}, 0 });
+	}
+	section->durations_ns.at(section->calls % window) = duration_ns;
+	section->calls++;
+}
+
+bool Profiler::write_chrome_trace(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		fprintf(stderr, "Could not open %s to write a trace\n", path.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	// Until the buffer first fills, the oldest event is the first one
+	size_t oldest = (events.size() < capacity) ? 0 : next_event;
+	for (size_t i = 0; i < events.size(); i++) {
+		const Event& event = events.at((oldest + i) % events.size());
+		// Complete events, timestamps and durations in microseconds
+		fprintf(file,
+				"%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				(i == 0) ? "" : ",",
+				event.name,
+				event.thread,
+				static_cast<double>(event.start_ns) / 1e3,
+				static_cast<double>(event.duration_ns) / 1e3);
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+std::string Profiler::summary() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string text = "section        p50 ms   p99 ms";
+	std::vector<int64_t> durations_ns;
+	for (const Section& section : sections) {
+		durations_ns.assign(section.durations_ns.begin(),
+							section.durations_ns.begin() + static_cast<ptrdiff_t>(std::min(section.calls, window)));
+		std::array<char, 64> line = {};
+		snprintf(line.data(),
+				 line.size(),
+				 "\n%-12s %8.3f %8.3f",
+				 section.name,
+				 percentile_ms(durations_ns, 0.5),
+				 percentile_ms(durations_ns, 0.99));
+		text += line.data();
+	}
+	return text;
+}
+
+void Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	origin = Clock::now();
+	events.clear();
+	next_event = 0;
+	sections.clear();
+}
+
+#endif
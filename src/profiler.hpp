@@ -0,0 +1,102 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timers for the systems' steps and the hot spots inside them
+// Every timed scope goes into a ring buffer that can be saved as Chrome trace_event JSON, for chrome://tracing or
+// ui.perfetto.dev, and into a rolling window per section for the p50 / p99 shown by the debug overlay
+// Only built with ENABLE_PROFILER, which debug builds define, otherwise PROFILE_SCOPE compiles to nothing
+#ifdef ENABLE_PROFILER
+class Profiler {
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	// Scopes past this many are overwritten, oldest first
+	static constexpr size_t capacity = 1 << 16;
+	// Calls of each section the percentiles are taken over
+	static constexpr size_t window = 240;
+
+	// Times from its construction to its destruction under the given name, which must outlive the profiler
+	class Scope {
+	public:
+		explicit Scope(const char* name)
+			: profiler(current())
+			, name(name)
+			, start(Clock::now())
+		{
+		}
+		~Scope() { profiler.record(name, start, Clock::now()); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(Scope&&) = delete;
+
+	private:
+		Profiler& profiler;
+		const char* name;
+		Clock::time_point start;
+	};
+
+	// Records into the given profiler rather than the thread's own while it lives, for work done on another thread's
+	// behalf, e.g. by a ThreadPool worker
+	class Redirect {
+	public:
+		explicit Redirect(Profiler* target);
+		~Redirect();
+
+		Redirect(const Redirect&) = delete;
+		Redirect& operator=(const Redirect&) = delete;
+		Redirect(Redirect&&) = delete;
+		Redirect& operator=(Redirect&&) = delete;
+
+	private:
+		Profiler* previous;
+	};
+
+	// Like the registry, each thread has a profiler of its own, so games on other threads don't mix into it
+	static Profiler& current();
+
+	void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+	// Writes the buffered scopes oldest first, returns false if the file can't be written
+	bool write_chrome_trace(const std::string& path) const;
+	// A line per section with the median and 99th percentile of its recent calls, in milliseconds
+	std::string summary() const;
+	void clear();
+
+private:
+	struct Event {
+		const char* name;
+		uint32_t thread;
+		int64_t start_ns;
+		int64_t duration_ns;
+	};
+
+	struct Section {
+		const char* name;
+		std::array<int64_t, window> durations_ns;
+		size_t calls;
+	};
+
+	// Scopes from a ThreadPool batch arrive from several threads at once
+	mutable std::mutex mutex;
+	Clock::time_point origin = Clock::now();
+	std::vector<Event> events;
+	size_t next_event = 0;
+	// Few enough that a linear search by name beats hashing
+	std::vector<Section> sections;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
@@ -0,0 +1,38 @@
+#include "random_streams.hpp"
+
+namespace {
+// SplitMix64, spreads nearby seeds (e.g. one per stream) far apart
+uint64_t mix(uint64_t value)
+{
+	value += 0x9e3779b97f4a7c15;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+	return value ^ (value >> 31);
+}
+} // namespace
+
+RandomStreams::RandomStreams(uint64_t seed)
+{
+	for (auto& engine : engines) {
+		engine = std::make_shared<std::default_random_engine>();
+	}
+	set_seed(seed);
+}
+
+void RandomStreams::set_seed(uint64_t new_seed)
+{
+	seed = new_seed;
+	for (size_t i = 0; i < engines.size(); i++) {
+		uint64_t stream_seed = mix(seed ^ mix(i));
+		std::seed_seq sequence = { static_cast<uint32_t>(stream_seed), static_cast<uint32_t>(stream_seed >> 32) };
+		engines.at(i)->seed(sequence);
+	}
+}
+
+uint64_t RandomStreams::get_next_seed() const { return mix(seed); }
+
+uint64_t RandomStreams::make_seed()
+{
+	std::random_device device;
+	return (static_cast<uint64_t>(device()) << 32) | device();
+}
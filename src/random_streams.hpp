@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+// Every random engine in a game, each derived from a single game seed.
+// Systems get a stream of their own, so how many numbers one of them draws never shifts what another sees, and the
+// same seed with the same inputs replays a game exactly.
+class RandomStreams {
+public:
+	enum class Stream : uint8_t {
+		Combat = 0,
+		Loot = Combat + 1,
+		AI = Loot + 1,
+		Count = AI + 1,
+	};
+
+	explicit RandomStreams(uint64_t seed = make_seed());
+
+	// Restarts every stream from a new game seed
+	void set_seed(uint64_t new_seed);
+	uint64_t get_seed() const { return seed; }
+
+	// Seed for the game after this one, so a run of restarts is reproducible from the first seed too
+	uint64_t get_next_seed() const;
+
+	// Engines keep their identity across set_seed, so holding on to one is fine
+	std::shared_ptr<std::default_random_engine> get(Stream stream) const
+	{
+		return engines.at(static_cast<size_t>(stream));
+	}
+
+	// A seed from the OS, for when nothing asked for a particular one
+	static uint64_t make_seed();
+
+private:
+	uint64_t seed = 0;
+	std::array<std::shared_ptr<std::default_random_engine>, static_cast<size_t>(Stream::Count)> engines;
+};
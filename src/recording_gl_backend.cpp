@@ -0,0 +1,173 @@
+#include "recording_gl_backend.hpp"
+
+thread_local RecordingGLBackend* RecordingGLBackend::active = nullptr;
+
+namespace {
+using CallType = RecordingGLBackend::CallType;
+
+// Every GL function the renderer uses that has nothing to hand back, with how it is counted
+#define RECORDED_GL_CALLS(X)                    \
+	X(glDrawArrays, Draw)                       \
+	X(glDrawElements, Draw)                     \
+	X(glDrawElementsInstanced, Draw)            \
+	X(glUseProgram, ProgramBind)                \
+	X(glBindVertexArray, VertexArrayBind)       \
+	X(glActiveTexture, TextureBind)             \
+	X(glBindTexture, TextureBind)               \
+	X(glBindBuffer, BufferBind)                 \
+	X(glBindFramebuffer, FramebufferBind)       \
+	X(glBindRenderbuffer, FramebufferBind)      \
+	X(glUniform1f, UniformUpload)               \
+	X(glUniform1i, UniformUpload)               \
+	X(glUniform1ui, UniformUpload)              \
+	X(glUniform1uiv, UniformUpload)             \
+	X(glUniform2f, UniformUpload)               \
+	X(glUniform2fv, UniformUpload)              \
+	X(glUniform2iv, UniformUpload)              \
+	X(glUniform3fv, UniformUpload)              \
+	X(glUniform4fv, UniformUpload)              \
+	X(glUniformMatrix3fv, UniformUpload)        \
+	X(glBufferData, DataUpload)                 \
+	X(glTexImage2D, DataUpload)                 \
+	X(glTexSubImage2D, DataUpload)              \
+	X(glRenderbufferStorage, DataUpload)        \
+	X(glBlendFunc, State)                       \
+	X(glClear, State)                           \
+	X(glClearColor, State)                      \
+	X(glClearDepth, State)                      \
+	X(glDepthRange, State)                      \
+	X(glDisable, State)                         \
+	X(glEnable, State)                          \
+	X(glEnableVertexAttribArray, State)         \
+	X(glFramebufferRenderbuffer, State)         \
+	X(glFramebufferTexture, State)              \
+	X(glPixelStorei, State)                     \
+	X(glTexParameteri, State)                   \
+	X(glVertexAttribDivisor, State)             \
+	X(glVertexAttribIPointer, State)            \
+	X(glVertexAttribPointer, State)             \
+	X(glViewport, State)                        \
+	X(glAttachShader, Resource)                 \
+	X(glBindAttribLocation, Resource)           \
+	X(glCompileShader, Resource)                \
+	X(glDeleteBuffers, Resource)                \
+	X(glDeleteFramebuffers, Resource)           \
+	X(glDeleteProgram, Resource)                \
+	X(glDeleteRenderbuffers, Resource)          \
+	X(glDeleteShader, Resource)                 \
+	X(glDeleteTextures, Resource)               \
+	X(glDeleteVertexArrays, Resource)           \
+	X(glDetachShader, Resource)                 \
+	X(glLinkProgram, Resource)                  \
+	X(glShaderSource, Resource)                 \
+	X(glGetError, Query)                        \
+	X(glGetProgramInfoLog, Query)               \
+	X(glGetShaderInfoLog, Query)
+
+#define DECLARE_GL_CALL_NAME(proc, type) constexpr char proc##_name[] = #proc;
+RECORDED_GL_CALLS(DECLARE_GL_CALL_NAME)
+#undef DECLARE_GL_CALL_NAME
+
+// Stub with the exact signature of the function it replaces, returning zero (GL_NO_ERROR for glGetError)
+template <CallType type, const char* name, typename Proc> struct Recorder;
+template <CallType type, const char* name, typename Result, typename... Args>
+struct Recorder<type, name, Result(APIENTRYP)(Args...)> {
+	static Result APIENTRY call(Args... /*args*/)
+	{
+		RecordingGLBackend::active->record(name, type);
+		return Result();
+	}
+};
+
+template <typename Size> void gen_ids(const char* name, Size n, GLuint* ids)
+{
+	RecordingGLBackend::active->record(name, CallType::Resource);
+	for (Size i = 0; i < n; i++) {
+		ids[i] = RecordingGLBackend::active->next_id();
+	}
+}
+
+void APIENTRY record_gen_buffers(GLsizei n, GLuint* ids) { gen_ids("glGenBuffers", n, ids); }
+void APIENTRY record_gen_framebuffers(GLsizei n, GLuint* ids) { gen_ids("glGenFramebuffers", n, ids); }
+void APIENTRY record_gen_renderbuffers(GLsizei n, GLuint* ids) { gen_ids("glGenRenderbuffers", n, ids); }
+void APIENTRY record_gen_textures(GLsizei n, GLuint* ids) { gen_ids("glGenTextures", n, ids); }
+void APIENTRY record_gen_vertex_arrays(GLsizei n, GLuint* ids) { gen_ids("glGenVertexArrays", n, ids); }
+
+GLuint APIENTRY record_create_program()
+{
+	RecordingGLBackend::active->record("glCreateProgram", CallType::Resource);
+	return RecordingGLBackend::active->next_id();
+}
+
+GLuint APIENTRY record_create_shader(GLenum /*type*/)
+{
+	RecordingGLBackend::active->record("glCreateShader", CallType::Resource);
+	return RecordingGLBackend::active->next_id();
+}
+
+// Every shader compiles and every program links
+void APIENTRY record_get_shaderiv(GLuint /*shader*/, GLenum /*pname*/, GLint* params)
+{
+	RecordingGLBackend::active->record("glGetShaderiv", CallType::Query);
+	*params = GL_TRUE;
+}
+
+void APIENTRY record_get_programiv(GLuint /*program*/, GLenum /*pname*/, GLint* params)
+{
+	RecordingGLBackend::active->record("glGetProgramiv", CallType::Query);
+	*params = GL_TRUE;
+}
+
+GLint APIENTRY record_get_uniform_location(GLuint /*program*/, const GLchar* /*name*/)
+{
+	RecordingGLBackend::active->record("glGetUniformLocation", CallType::Query);
+	return static_cast<GLint>(RecordingGLBackend::active->next_id());
+}
+
+GLenum APIENTRY record_check_framebuffer_status(GLenum /*target*/)
+{
+	RecordingGLBackend::active->record("glCheckFramebufferStatus", CallType::Query);
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+} // namespace
+
+RecordingGLBackend::~RecordingGLBackend()
+{
+	if (active == this) {
+		active = nullptr;
+	}
+}
+
+void RecordingGLBackend::install()
+{
+	assert(active == nullptr || active == this);
+	active = this;
+
+#define INSTALL_GL_CALL(proc, type) proc = &Recorder<CallType::type, proc##_name, decltype(proc)>::call;
+	RECORDED_GL_CALLS(INSTALL_GL_CALL)
+#undef INSTALL_GL_CALL
+
+	glGenBuffers = &record_gen_buffers;
+	glGenFramebuffers = &record_gen_framebuffers;
+	glGenRenderbuffers = &record_gen_renderbuffers;
+	glGenTextures = &record_gen_textures;
+	glGenVertexArrays = &record_gen_vertex_arrays;
+	glCreateProgram = &record_create_program;
+	glCreateShader = &record_create_shader;
+	glGetShaderiv = &record_get_shaderiv;
+	glGetProgramiv = &record_get_programiv;
+	glGetUniformLocation = &record_get_uniform_location;
+	glCheckFramebufferStatus = &record_check_framebuffer_status;
+}
+
+void RecordingGLBackend::record(const char* name, CallType type)
+{
+	calls.push_back({ name, type });
+	counts.at(static_cast<size_t>(type))++;
+}
+
+void RecordingGLBackend::clear()
+{
+	calls.clear();
+	counts.fill(0);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "common.hpp"
+
+// Stand-in for the OpenGL driver, used to run the renderer where there is no display or GPU.
+// Installing it points gl3w's function pointers at stubs that log each call instead of issuing it,
+// so RenderSystem::init and RenderSystem::draw run unchanged and what they would have sent to GL
+// can be inspected, counted or timed.
+// Calls that hand back objects (glGen*, glCreate*, glGetUniformLocation) get fresh ids, and status
+// queries always report success.
+class RecordingGLBackend {
+public:
+	enum class CallType : uint8_t {
+		Draw = 0,
+		ProgramBind = Draw + 1,
+		VertexArrayBind = ProgramBind + 1,
+		TextureBind = VertexArrayBind + 1,
+		BufferBind = TextureBind + 1,
+		FramebufferBind = BufferBind + 1,
+		UniformUpload = FramebufferBind + 1,
+		// Buffer and texture contents
+		DataUpload = UniformUpload + 1,
+		// Anything else that changes pipeline state, e.g. blending or the viewport
+		State = DataUpload + 1,
+		// Creating, compiling and deleting objects
+		Resource = State + 1,
+		Query = Resource + 1,
+		Count = Query + 1,
+	};
+
+	struct Call {
+		const char* name;
+		CallType type;
+	};
+
+	RecordingGLBackend() = default;
+	~RecordingGLBackend();
+	RecordingGLBackend(const RecordingGLBackend&) = delete;
+	RecordingGLBackend& operator=(const RecordingGLBackend&) = delete;
+	RecordingGLBackend(RecordingGLBackend&&) = delete;
+	RecordingGLBackend& operator=(RecordingGLBackend&&) = delete;
+
+	// Replaces gl3w's function pointers, call instead of gl3w_init
+	// Only one backend can be installed at a time on each thread
+	void install();
+
+	// Every call since the last clear, in the order they were made
+	const std::vector<Call>& get_calls() const { return calls; }
+	size_t count(CallType type) const { return counts.at(static_cast<size_t>(type)); }
+	void clear();
+
+	// Used by the stubs, per thread so games on different threads record separately
+	static thread_local RecordingGLBackend* active;
+	void record(const char* name, CallType type);
+	GLuint next_id() { return ++last_id; }
+
+private:
+	std::vector<Call> calls;
+	std::array<size_t, static_cast<size_t>(CallType::Count)> counts = {};
+	GLuint last_id = 0;
+};
@@ -1,6 +1,9 @@
 // internal
 #include "render_system.hpp"
+#include "profiler.hpp"
 #include <SDL.h>
+#include <algorithm>
+#include <limits>
 #pragma warning(push)
 #pragma warning(disable : 4201) // nameless struct; glm only uses it if it exists
 #include <glm/gtc/type_ptr.hpp> // Allows nice passing of values to GL functions
@@ -12,7 +15,7 @@ Transform RenderSystem::get_transform(Entity entity, uvec2* tile) const
 	if (WorldPosition* world_pos = registry.try_get<WorldPosition>(entity)) {
 		// Most objects in the game are expected to use MapPosition, exceptions are:
 		// Arrow, Room.
-		transform.translate(world_pos->position);
+		transform.translate(interpolate_position(entity, world_pos->position));
 		if (Velocity* velocity = registry.try_get<Velocity>(entity)) {
 			// Probably can provide a get if exist function here to boost performance
 			transform.rotate(velocity->angle);
@@ -31,6 +34,14 @@ Transform RenderSystem::get_transform(Entity entity, uvec2* tile) const
 	return transform;
 }
 
+vec2 RenderSystem::interpolate_position(Entity entity, vec2 position) const
+{
+	if (interpolation >= 1.f || !registry.all_of<Velocity, PreviousWorldPosition>(entity)) {
+		return position;
+	}
+	return mix(registry.get<PreviousWorldPosition>(entity).position, position, interpolation);
+}
+
 Transform RenderSystem::get_transform_no_rotation(Entity entity) const
 {
 	Transform transform;
@@ -40,17 +51,19 @@ Transform RenderSystem::get_transform_no_rotation(Entity entity) const
 	} else if (registry.any_of<WorldPosition>(entity)) {
 		// Most objects in the game are expected to use MapPosition, exceptions are:
 		// Arrow, Room.
-		transform.translate(registry.get<WorldPosition>(entity).position);
+		transform.translate(interpolate_position(entity, registry.get<WorldPosition>(entity).position));
 	} else {
 		transform.translate(screen_position_to_world_position(registry.get<ScreenPosition>(entity).position));
 	}
 	return transform;
 }
 
-void RenderSystem::prepare_buffer(vec3 color) const
+void RenderSystem::prepare_buffer(vec3 color) const { prepare_buffer(color, ivec2(screen_size_capped())); }
+
+void RenderSystem::prepare_buffer(vec3 color, ivec2 viewport_size) const
 {
 	// Clearing backbuffer
-	glViewport(0, 0, (GLsizei)screen_size_capped().x, (GLsizei)screen_size_capped().y);
+	glViewport(0, 0, viewport_size.x, viewport_size.y);
 	glDepthRange(0.00001, 10);
 	glClearColor(color.r, color.g, color.b, 1.0);
 	glClearDepth(1.f);
@@ -63,117 +76,139 @@ void RenderSystem::prepare_buffer(vec3 color) const
 	gl_has_errors();
 }
 
-void RenderSystem::prepare_for_textured(GLuint texture_id)
+const RenderSystem::EffectInterface& RenderSystem::use_effect(EFFECT_ASSET_ID effect)
 {
-	const auto program = (GLuint)effects.at((uint8)EFFECT_ASSET_ID::TEXTURED);
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
+	assert(effect != EFFECT_ASSET_ID::EFFECT_COUNT);
+	if (effect == current_effect) {
+		frame_stats.redundant_binds++;
+		return effect_interfaces.at((GLuint)effect);
+	}
+	glUseProgram(effects.at((GLuint)effect));
 	gl_has_errors();
-	assert(in_texcoord_loc >= 0);
+	current_effect = effect;
+	frame_stats.program_binds++;
+	return effect_interfaces.at((GLuint)effect);
+}
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void RenderSystem::bind_geometry(GEOMETRY_BUFFER_ID geometry)
+{
+	assert(geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+	bind_vertex_array(vertex_arrays.at((GLuint)geometry));
+	current_geometry = geometry;
+}
 
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), nullptr);
-	gl_has_errors();
+void RenderSystem::bind_instanced_geometry(GEOMETRY_BUFFER_ID geometry)
+{
+	assert(instanced_vertex_arrays.at((GLuint)geometry) != 0);
+	bind_vertex_array(instanced_vertex_arrays.at((GLuint)geometry));
+	current_geometry = geometry;
+}
 
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(
-		in_texcoord_loc,
-		2,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(TexturedVertex),
-		(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
+void RenderSystem::bind_vertex_array(GLuint vertex_array)
+{
+	if (vertex_array == current_vertex_array) {
+		frame_stats.redundant_binds++;
+		return;
+	}
+	glBindVertexArray(vertex_array);
 	gl_has_errors();
+	current_vertex_array = vertex_array;
+	frame_stats.vertex_array_binds++;
+}
 
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+void RenderSystem::bind_texture(GLuint unit, GLuint texture)
+{
+	if (bound_textures.at(unit) == texture) {
+		frame_stats.redundant_binds++;
+		return;
+	}
+	if (unit != active_texture_unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		active_texture_unit = unit;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
 	gl_has_errors();
+	bound_textures.at(unit) = texture;
+	frame_stats.texture_binds++;
 }
 
-void RenderSystem::prepare_for_spritesheet(TEXTURE_ASSET_ID texture, vec2 offset, vec2 size)
+void RenderSystem::reset_bind_cache()
 {
-	const auto program = (GLuint)effects.at((GLuint)EFFECT_ASSET_ID::SPRITESHEET);
-
-	// Setting shaders
-	glUseProgram(program);
+	current_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
+	current_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+	glUseProgram(0);
+	glBindVertexArray(0);
+	current_vertex_array = 0;
+	for (GLuint unit = 0; unit < bound_textures.size(); unit++) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	active_texture_unit = 0;
+	bound_textures.fill(0);
 	gl_has_errors();
+}
 
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::SPRITE);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::SPRITE);
+void RenderSystem::prepare_for_textured(GLuint texture_id)
+{
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
+	// Enabling and binding texture to slot 0
+	bind_texture(0, texture_id);
 	gl_has_errors();
-	assert(in_texcoord_loc >= 0);
+}
+
+void RenderSystem::prepare_for_spritesheet(TEXTURE_ASSET_ID texture, vec2 offset, vec2 size)
+{
+	// Setting shaders
+	const EffectInterface& effect = use_effect(EFFECT_ASSET_ID::SPRITESHEET);
+	bind_geometry(GEOMETRY_BUFFER_ID::SPRITE);
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), nullptr);
+	upload_uniform(glUniform2f, effect.offset, offset.x, offset.y);
+	upload_uniform(glUniform2f, effect.size, size.x, size.y);
 	gl_has_errors();
 
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(
-		in_texcoord_loc,
-		2,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(TexturedVertex),
-		(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
 	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
-	gl_has_errors();
-
-	GLint offset_loc = glGetUniformLocation(program, "offset");
-	glUniform2f(offset_loc, offset.x, offset.y);
+	bind_texture(0, texture_gl_handles.at((GLuint)texture));
 	gl_has_errors();
+}
 
-	GLint size_loc = glGetUniformLocation(program, "size");
-	glUniform2f(size_loc, size.x,size.y);
-	gl_has_errors();
+TTF_Font* RenderSystem::get_font(bool cursive, unsigned int font_size)
+{
+	// Check if we have the font in the right size, otherwise load it
+	auto& sized_fonts = (cursive) ? cursive_fonts : fonts;
+	auto font_itr = sized_fonts.find(font_size);
+	if (font_itr == sized_fonts.end()) {
+		const std::string path = fonts_path((cursive) ? "Gwendolyn-Regular.ttf" : "VT323-Regular.ttf");
+		font_itr = sized_fonts.emplace(font_size, TTF_OpenFont(path.c_str(), static_cast<int>(font_size))).first;
+	}
+	return font_itr->second;
+}
 
-	GLuint texture_id = texture_gl_handles.at((GLuint)texture);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	gl_has_errors();
+GlyphAtlas& RenderSystem::get_glyph_atlas(bool cursive, unsigned int font_size)
+{
+	auto atlas_itr = glyph_atlases.find({ cursive, font_size });
+	if (atlas_itr == glyph_atlases.end()) {
+		atlas_itr = glyph_atlases.emplace(std::make_pair(cursive, font_size), GlyphAtlas()).first;
+		// Building uploads through texture unit 0 and leaves nothing bound there, which keeps the bind cache right
+		bind_texture(0, 0);
+		atlas_itr->second.build(get_font(cursive, font_size));
+	}
+	return atlas_itr->second;
 }
 
 RenderSystem::TextData RenderSystem::generate_text(const Text& text, bool cursive)
 {
+	PROFILE_SCOPE("text");
 	TextData text_data = {};
 	// Texture creation
 	glGenTextures(1, &(text_data.texture));
 
-	// Check if we have the font in the right size, otherwise load it
-	TTF_Font* font = nullptr;
-	if (cursive) {
-		auto font_itr = cursive_fonts.find(text.font_size);
-		if (font_itr != cursive_fonts.end()) {
-			font = font_itr->second;
-		} else {
-			font = cursive_fonts
-					   .emplace(text.font_size,
-								TTF_OpenFont(fonts_path("Gwendolyn-Regular.ttf").c_str(), text.font_size))
-					   .first->second;
-		}
-	} else {
-		auto font_itr = fonts.find(text.font_size);
-		if (font_itr != fonts.end()) {
-			font = font_itr->second;
-		} else {
-			font = fonts.emplace(text.font_size, TTF_OpenFont(fonts_path("VT323-Regular.ttf").c_str(), text.font_size))
-					   .first->second;
-		}
-	}
+	TTF_Font* font = get_font(cursive, text.font_size);
 
 	const std::string& string = text.text;
 
@@ -234,7 +269,7 @@ RenderSystem::TextData RenderSystem::generate_text(const Text& text, bool cursiv
 	}
 
 	// Extract the SDL image data into the texture
-	glBindTexture(GL_TEXTURE_2D, text_data.texture);
+	bind_texture(0, text_data.texture);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glTexImage2D(GL_TEXTURE_2D,
 				 0,
@@ -248,7 +283,7 @@ RenderSystem::TextData RenderSystem::generate_text(const Text& text, bool cursiv
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	bind_texture(0, 0);
 	gl_has_errors();
 
 	// Free single surface
@@ -265,24 +300,11 @@ void RenderSystem::draw_textured_mesh(Entity entity, const RenderRequest& render
 
 	transform.scale(scaling_factors.at(static_cast<int>(render_request.used_texture)));
 
-	const auto used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const auto program = (GLuint)effects.at(used_effect_enum);
-
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	int vbo_ibo_offset = 0;
-
-	const GLuint vbo = vertex_buffers.at((int)render_request.used_geometry + vbo_ibo_offset);
-	const GLuint ibo = index_buffers.at((int)render_request.used_geometry + vbo_ibo_offset);
+	const EffectInterface& effect = use_effect(render_request.used_effect);
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
+	bind_geometry(render_request.used_geometry);
 
 	// Input data location as in the vertex buffer
 	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED) {
@@ -303,27 +325,6 @@ void RenderSystem::draw_textured_mesh(Entity entity, const RenderRequest& render
 			return;
 		}
 
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(SmallSpriteVertex), nullptr);
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc,
-			2,
-			GL_FLOAT,
-			GL_FALSE,
-			sizeof(SmallSpriteVertex),
-			(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
 		Animation& animation = registry.get<Animation>(entity);
 		assert(registry.any_of<Animation>(entity));
 
@@ -331,18 +332,12 @@ void RenderSystem::draw_textured_mesh(Entity entity, const RenderRequest& render
 		transform.scale({ animation.direction, 1 });
 
 		// Updates frame for entity
-		GLint frame_loc = glGetUniformLocation(program, "frame");
-		glUniform1i(frame_loc, animation.frame);
+		upload_uniform(glUniform1i, effect.frame, animation.frame);
+		upload_uniform(glUniform1i, effect.state, animation.state);
 		gl_has_errors();
 
-		// Updates frame for entity
-		GLint state_loc = glGetUniformLocation(program, "state");
-		glUniform1i(state_loc, animation.state);
-		gl_has_errors();
-
-		GLuint texture_id = texture_gl_handles.at((GLuint)render_request.used_texture);
-
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		// Enabling and binding texture to slot 0
+		bind_texture(0, texture_gl_handles.at((GLuint)render_request.used_texture));
 		gl_has_errors();
 
 	} else {
@@ -351,90 +346,220 @@ void RenderSystem::draw_textured_mesh(Entity entity, const RenderRequest& render
 
 	// Getting uniform locations for glUniform* calls
 	if (registry.any_of<Animation>(entity)) {
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
-		GLint opacity_uloc = glGetUniformLocation(program, "opacity");
 		const vec4 color = registry.get<Animation>(entity).display_color;
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
-		glUniform1f(opacity_uloc, color.w);
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
+		upload_uniform(glUniform1f, effect.opacity, color.w);
 		gl_has_errors();
 	} else if (registry.any_of<Color>(entity)) {
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
 		const vec3 color = registry.get<Color>(entity).color;
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
 		gl_has_errors();
 	}
 
-	prepare_for_lit_entity(program);
+	prepare_for_lit_entity(effect);
 
 	draw_triangles(transform, projection);
 }
 
-void RenderSystem::draw_effect(Entity entity, const EffectRenderRequest& render_request, const mat3& projection)
+bool RenderSystem::batch_sprite(Entity entity, const RenderRequest& render_request)
 {
-	Transform transform = get_transform_no_rotation(entity);
+	bool animated = (render_request.used_effect == EFFECT_ASSET_ID::ENEMY
+					 || render_request.used_effect == EFFECT_ASSET_ID::PLAYER)
+		&& render_request.used_geometry == GEOMETRY_BUFFER_ID::SMALL_SPRITE;
+	bool spritesheet = render_request.used_effect == EFFECT_ASSET_ID::SPRITESHEET
+		&& render_request.used_geometry == GEOMETRY_BUFFER_ID::SPRITE;
+	if (!animated && !spritesheet) {
+		return false;
+	}
 
+	uvec2 tile;
+	Transform transform = get_transform(entity, &tile);
 	transform.scale(scaling_factors.at(static_cast<int>(render_request.used_texture)));
 
-	const auto used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const auto program = (GLuint)effects.at(used_effect_enum);
+	SpriteInstance instance = {};
+	instance.color = vec4(1);
+	if (animated) {
+		if (!lighting.is_visible(tile)) {
+			return true;
+		}
+		Animation& animation = registry.get<Animation>(entity);
+		// Switches direction based on requested animation direction
+		transform.scale({ animation.direction, 1 });
+		instance.frame = vec4(animation.frame, animation.state, 0, 0);
+	} else {
+		TextureOffset& texture_offset = registry.get<TextureOffset>(entity);
+		instance.frame = vec4(vec2(texture_offset.offset) * MapUtility::tile_size, texture_offset.size);
+	}
 
-	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
+	if (Animation* animation = registry.try_get<Animation>(entity)) {
+		instance.color = animation->display_color;
+	} else if (Color* color = registry.try_get<Color>(entity)) {
+		instance.color = vec4(color->color, 1);
+	}
+	instance.transform = transform.mat;
 
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	int vbo_ibo_offset = 0;
+	sprite_batches[{ render_request.used_effect, render_request.used_texture }].push_back(instance);
+	return true;
+}
 
-	const GLuint vbo = vertex_buffers.at((int)render_request.used_geometry + vbo_ibo_offset);
-	const GLuint ibo = index_buffers.at((int)render_request.used_geometry + vbo_ibo_offset);
+void RenderSystem::batch_health_bar(Entity entity, const Stats& stats)
+{
+	uvec2 tile;
+	Transform transform = get_transform(entity, &tile);
+	if (!lighting.is_visible(tile)) {
+		return;
+	}
+	vec2 shift = vec2(2 - MapUtility::tile_size / 2, -MapUtility::tile_size / 2);
+	vec2 scale = vec2(MapUtility::tile_size - 4, 3);
+	bool fancy = false;
+	if (MapHitbox* hitbox = registry.try_get<MapHitbox>(entity)) {
+		shift.x -= MapUtility::tile_size * hitbox->center.x;
+		shift.y -= MapUtility::tile_size * hitbox->center.y;
+		scale.x = MapUtility::tile_size * hitbox->area.x - 4;
+		scale.y = min(9.f, hitbox->area.x * scale.y);
+		fancy = true;
+	}
+	transform.translate(shift);
+	transform.scale(scale);
 
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
+	SpriteInstance instance = {};
+	instance.transform = transform.mat;
+	// Fancy bars in the world belong to bosses, which always use the default red
+	instance.color = vec4(.8, .1, .1, 1);
+	instance.frame = vec4(get_stat_bar_fill(stats, fancy, entity), scale.x / scale.y, 0, 0);
 
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
+	EFFECT_ASSET_ID effect = (fancy) ? EFFECT_ASSET_ID::FANCY_HEALTH : EFFECT_ASSET_ID::HEALTH;
+	overlay_batches[{ effect, TEXTURE_ASSET_ID::TEXTURE_COUNT }].push_back(instance);
+}
 
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(SmallSpriteVertex), nullptr);
+void RenderSystem::batch_conditions(Entity entity, const ActiveConditions& conditions)
+{
+	uvec2 tile;
+	Transform transform = get_transform(entity, &tile);
+	if (!lighting.is_visible(tile)) {
+		return;
+	}
+
+	std::vector<SpriteInstance>& batch
+		= overlay_batches[{ EFFECT_ASSET_ID::COMBAT_COND, TEXTURE_ASSET_ID::COMBAT_CONDS }];
+	float condition_offset = 0.f;
+	for (size_t condition_index = 0; condition_index < num_conditions; condition_index++) {
+		if (conditions.conditions.at(condition_index) == 0) {
+			continue;
+		}
+		Transform condition_transform = transform;
+		condition_transform.translate(condition_offset * combat_effect_offset);
+		condition_transform.scale(scaling_factors.at(static_cast<int>(TEXTURE_ASSET_ID::COMBAT_CONDS)));
+
+		SpriteInstance& instance = batch.emplace_back();
+		instance.transform = condition_transform.mat;
+		instance.color = vec4(1);
+		instance.frame = vec4(0, condition_index, 0, 0);
+		condition_offset += 1.f;
+	}
+}
+
+void RenderSystem::draw_instance_batches(InstanceBatches& batches, const mat3& projection)
+{
+	for (auto& [key, instances] : batches) {
+		if (instances.empty()) {
+			continue;
+		}
+		auto [effect_id, texture] = key;
+
+		EFFECT_ASSET_ID instanced_effect = EFFECT_ASSET_ID::SPRITESHEET_INSTANCED;
+		GEOMETRY_BUFFER_ID geometry = GEOMETRY_BUFFER_ID::SPRITE;
+		switch (effect_id) {
+		case EFFECT_ASSET_ID::ENEMY:
+			instanced_effect = EFFECT_ASSET_ID::ENEMY_INSTANCED;
+			geometry = GEOMETRY_BUFFER_ID::SMALL_SPRITE;
+			break;
+		case EFFECT_ASSET_ID::PLAYER:
+			instanced_effect = EFFECT_ASSET_ID::PLAYER_INSTANCED;
+			geometry = GEOMETRY_BUFFER_ID::SMALL_SPRITE;
+			break;
+		case EFFECT_ASSET_ID::HEALTH:
+			instanced_effect = EFFECT_ASSET_ID::HEALTH_INSTANCED;
+			geometry = GEOMETRY_BUFFER_ID::HEALTH;
+			break;
+		case EFFECT_ASSET_ID::FANCY_HEALTH:
+			instanced_effect = EFFECT_ASSET_ID::FANCY_HEALTH_INSTANCED;
+			geometry = GEOMETRY_BUFFER_ID::HEALTH;
+			break;
+		case EFFECT_ASSET_ID::COMBAT_COND:
+			instanced_effect = EFFECT_ASSET_ID::COMBAT_COND_INSTANCED;
+			geometry = GEOMETRY_BUFFER_ID::SMALL_SPRITE;
+			break;
+		default:
+			break;
+		}
+
+		// Setting shaders
+		const EffectInterface& effect = use_effect(instanced_effect);
+
+		// The instanced vertex array already reads the per instance attributes from the instance buffer
+		bind_instanced_geometry(geometry);
+		glBindBuffer(GL_ARRAY_BUFFER, sprite_instance_buffer);
+		glBufferData(GL_ARRAY_BUFFER,
+					 static_cast<GLsizeiptr>(sizeof(SpriteInstance) * instances.size()),
+					 instances.data(),
+					 GL_STREAM_DRAW);
 		gl_has_errors();
 
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc,
-			2,
-			GL_FLOAT,
-			GL_FALSE,
-			sizeof(SmallSpriteVertex),
-			(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
 		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
+		if (texture != TEXTURE_ASSET_ID::TEXTURE_COUNT) {
+			bind_texture(0, texture_gl_handles.at((GLuint)texture));
+			gl_has_errors();
+		}
 
-		Animation& animation = registry.get<Animation>(entity);
-		assert(registry.any_of<Animation>(entity));
+		if (effect_id == EFFECT_ASSET_ID::COMBAT_COND) {
+			// Updates time in shader program
+			upload_uniform(glUniform1f, effect.time, (float)(glfwGetTime() * 10.0f));
+		}
 
-		// Updates time in shader program
-		GLint time_uloc = glGetUniformLocation(program, "time");
-		glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+		prepare_for_lit_entity(effect);
 
-		// Updates frame for entity
-		GLint frame_loc = glGetUniformLocation(program, "frame");
-		glUniform1i(frame_loc, animation.frame);
+		upload_uniform(glUniformMatrix3fv, effect.projection, 1, GL_FALSE, glm::value_ptr(projection));
 		gl_has_errors();
 
-		// Updates frame for entity
-		GLint state_loc = glGetUniformLocation(program, "state");
-		glUniform1i(state_loc, animation.state);
+		frame_stats.draws++;
+		glDrawElementsInstanced(GL_TRIANGLES,
+								index_counts.at((GLuint)geometry),
+								GL_UNSIGNED_SHORT,
+								nullptr,
+								static_cast<GLsizei>(instances.size()));
+		gl_has_errors();
+
+		instances.clear();
+	}
+}
+
+void RenderSystem::draw_effect(Entity entity, const EffectRenderRequest& render_request, const mat3& projection)
+{
+	Transform transform = get_transform_no_rotation(entity);
+
+	transform.scale(scaling_factors.at(static_cast<int>(render_request.used_texture)));
+
+	// Setting shaders
+	const EffectInterface& effect = use_effect(render_request.used_effect);
+
+	// Setting vertex and index buffers
+	bind_geometry(render_request.used_geometry);
+
+	Animation& animation = registry.get<Animation>(entity);
+	assert(registry.any_of<Animation>(entity));
+
+	// Updates time in shader program
+	upload_uniform(glUniform1f, effect.time, (float)(glfwGetTime() * 10.0f));
+
+	// Updates frame for entity
+	upload_uniform(glUniform1i, effect.frame, animation.frame);
+	upload_uniform(glUniform1i, effect.state, animation.state);
+	gl_has_errors();
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::SPELL) {
 		// Updates frame for entity
-		GLint spell_loc = glGetUniformLocation(program, "spelltype");
-		glUniform1i(spell_loc, animation.state);
+		upload_uniform(glUniform1i, effect.spelltype, animation.state);
 	}
 
 	if (render_request.used_effect == EFFECT_ASSET_ID::AOE) {
@@ -443,116 +568,35 @@ void RenderSystem::draw_effect(Entity entity, const EffectRenderRequest& render_
 		if (!aoe_status.actual_attack_displayed) {
 			transform.scale(vec2(1 / 3.f, 1 / 3.f));
 		}
-		GLint actual_aoe = glGetUniformLocation(program, "actual_aoe");
-		glUniform1i(actual_aoe, static_cast<GLint>(aoe_status.actual_attack_displayed));
+		upload_uniform(glUniform1i, effect.actual_aoe, static_cast<GLint>(aoe_status.actual_attack_displayed));
 	}
 	if (render_request.used_effect == EFFECT_ASSET_ID::DEATH) {
 		DeathDeformation& death_deformation = registry.get<DeathDeformation>(entity);
-		GLfloat side_offest = glGetUniformLocation(program, "side_offset");
-		glUniform1f(side_offest, static_cast<GLfloat>(death_deformation.side_direction));
-		GLfloat height_offset = glGetUniformLocation(program, "height_offset");
-		glUniform1f(height_offset, static_cast<GLfloat>(death_deformation.height_direction));
-		GLint direction = glGetUniformLocation(program, "direction");
-		glUniform1i(direction, static_cast<GLint>(animation.direction));
+		upload_uniform(glUniform1f, effect.side_offset, static_cast<GLfloat>(death_deformation.side_direction));
+		upload_uniform(glUniform1f, effect.height_offset, static_cast<GLfloat>(death_deformation.height_direction));
+		upload_uniform(glUniform1i, effect.direction, static_cast<GLint>(animation.direction));
 		transform.scale({ animation.direction, 1 });
 	}
 
-	GLuint texture_id = texture_gl_handles.at((GLuint)render_request.used_texture);
-
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	// Enabling and binding texture to slot 0
+	bind_texture(0, texture_gl_handles.at((GLuint)render_request.used_texture));
 	gl_has_errors();
 
 	// Getting uniform locations for glUniform* calls
 	if (registry.any_of<Animation>(entity)) {
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
-		GLint opacity_uloc = glGetUniformLocation(program, "opacity");
 		const vec4 color = registry.get<Animation>(entity).display_color;
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
-		glUniform1f(opacity_uloc, color.w);
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
+		upload_uniform(glUniform1f, effect.opacity, color.w);
 		gl_has_errors();
 	} else if (registry.any_of<Color>(entity)) {
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
 		const vec3 color = registry.get<Color>(entity).color;
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
 		gl_has_errors();
 	}
 
 	draw_triangles(transform, projection);
 }
 
-void RenderSystem::draw_condition(Entity entity, int condition_index, float condition_offset, const mat3& projection)
-{
-	uvec2 tile;
-	Transform transform = get_transform(entity, &tile);
-
-	transform.translate(condition_offset * combat_effect_offset);
-	transform.scale(scaling_factors.at(static_cast<int>(TEXTURE_ASSET_ID::COMBAT_CONDS)));
-	
-
-	const auto used_effect_enum = (GLuint)EFFECT_ASSET_ID::COMBAT_COND;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const auto program = (GLuint)effects.at(used_effect_enum);
-
-	if (!lighting.is_visible(tile)) {
-		return;
-	}
-
-	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	int vbo_ibo_offset = 0;
-
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::SMALL_SPRITE + vbo_ibo_offset);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::SMALL_SPRITE + vbo_ibo_offset);
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-	gl_has_errors();
-	assert(in_texcoord_loc >= 0);
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(SmallSpriteVertex), nullptr);
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_texcoord_loc);
-	glVertexAttribPointer(
-		in_texcoord_loc,
-		2,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(SmallSpriteVertex),
-		(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
-	gl_has_errors();
-
-	// Updates time in shader program
-	GLint time_uloc = glGetUniformLocation(program, "time");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-
-	// Updates frame for entity
-	GLint state_loc = glGetUniformLocation(program, "state");
-	glUniform1i(state_loc, condition_index);
-	gl_has_errors();
-
-	GLuint texture_id = texture_gl_handles.at((GLuint)TEXTURE_ASSET_ID::COMBAT_CONDS);
-
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	gl_has_errors();
-
-	prepare_for_lit_entity(program);
-
-	draw_triangles(transform, projection);
-}
-
 void RenderSystem::draw_ui_element(Entity entity, const UIRenderRequest& ui_render_request, const mat3& projection)
 {
 	Transform transform = get_transform(entity);
@@ -585,9 +629,8 @@ void RenderSystem::draw_ui_element(Entity entity, const UIRenderRequest& ui_rend
 		prepare_for_spritesheet(ui_render_request.used_texture, shifted_offset, texture_offset.size);
 
 		if (registry.any_of<Color>(entity)) {
-			GLint color_uloc = glGetUniformLocation((GLuint)effects.at((GLuint)EFFECT_ASSET_ID::SPRITESHEET), "fcolor");
 			const vec3 color = registry.get<Color>(entity).color;
-			glUniform3fv(color_uloc, 1, glm::value_ptr(color));
+			upload_uniform(glUniform3fv, effect_interfaces.at((GLuint)EFFECT_ASSET_ID::SPRITESHEET).fcolor, 1, glm::value_ptr(color));
 			gl_has_errors();
 		}
 
@@ -598,110 +641,49 @@ void RenderSystem::draw_ui_element(Entity entity, const UIRenderRequest& ui_rend
 void RenderSystem::draw_stat_bar(
 	Transform transform, const Stats& stats, const mat3& projection, bool fancy, float ratio = 1.f, Entity entity = entt::null)
 {
-	const auto program = (fancy) ? (GLuint)effects.at((uint8)EFFECT_ASSET_ID::FANCY_HEALTH)
-								 : (GLuint)effects.at((uint8)EFFECT_ASSET_ID::HEALTH);
-
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::HEALTH);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::HEALTH);
+	const EffectInterface& effect = use_effect((fancy) ? EFFECT_ASSET_ID::FANCY_HEALTH : EFFECT_ASSET_ID::HEALTH);
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	gl_has_errors();
+	bind_geometry(GEOMETRY_BUFFER_ID::HEALTH);
 
-	GLint in_color_loc = glGetAttribLocation(program, "in_color");
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_color_loc);
-	glVertexAttribPointer(
-		in_color_loc,
-		3,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(ColoredVertex),
-		(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-	gl_has_errors();
-
-	GLint health_loc = glGetUniformLocation(program, "health");
-	float percentage = 1.f;
-	if (fancy && registry.any_of<TargettedBar>(entity) && registry.get<TargettedBar>(entity).target == BarType::Mana) {
-		percentage = max(static_cast<float>(stats.mana), 0.f) / static_cast<float>(stats.mana_max);
-	} else {
-		percentage = max(static_cast<float>(stats.health), 0.f) / static_cast<float>(stats.health_max);
-	}
-	glUniform1f(health_loc, percentage);
+	upload_uniform(glUniform1f, effect.health, get_stat_bar_fill(stats, fancy, entity));
 
 	if (fancy) {
-		GLint xy_ratio_loc = glGetUniformLocation(program, "xy_ratio");
-		glUniform1f(xy_ratio_loc, ratio);
+		upload_uniform(glUniform1f, effect.xy_ratio, ratio);
 
 		// Setup coloring
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
 		vec3 color = vec3(.8, .1, .1);
 		if (registry.any_of<Color>(entity) && !registry.any_of<MapHitbox>(entity)) {
 			color = registry.get<Color>(entity).color;
 		}
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
 		gl_has_errors();
 	}
 
-	prepare_for_lit_entity(program);
+	prepare_for_lit_entity(effect);
 
 	draw_triangles(transform, projection);
 }
 
-void RenderSystem::draw_rectangle(EFFECT_ASSET_ID asset, Entity entity, Transform transform, vec2 scale, const mat3& projection)
+float RenderSystem::get_stat_bar_fill(const Stats& stats, bool fancy, Entity entity) const
 {
-	const auto program = (GLuint)effects.at((uint8)asset);
+	if (fancy && registry.any_of<TargettedBar>(entity) && registry.get<TargettedBar>(entity).target == BarType::Mana) {
+		return max(static_cast<float>(stats.mana), 0.f) / static_cast<float>(stats.mana_max);
+	}
+	return max(static_cast<float>(stats.health), 0.f) / static_cast<float>(stats.health_max);
+}
 
+void RenderSystem::draw_rectangle(EFFECT_ASSET_ID asset, Entity entity, Transform transform, vec2 scale, const mat3& projection)
+{
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::LINE);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::LINE);
+	const EffectInterface& effect = use_effect(asset);
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	gl_has_errors();
-
-	GLint in_color_loc = glGetAttribLocation(program, "in_color");
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
-	gl_has_errors();
+	bind_geometry(GEOMETRY_BUFFER_ID::LINE);
 
-	glEnableVertexAttribArray(in_color_loc);
-	glVertexAttribPointer(
-		in_color_loc,
-		3,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(ColoredVertex),
-		(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-	gl_has_errors();
-
-	GLint scale_loc = glGetUniformLocation(program, "scale");
-	glUniform2f(scale_loc, scale.x, scale.y);
-
-	GLint thickness_loc = glGetUniformLocation(program, "thickness");
-	glUniform1f(thickness_loc, asset == EFFECT_ASSET_ID::RECTANGLE ? 6 : 4);
+	upload_uniform(glUniform2f, effect.scale, scale.x, scale.y);
+	upload_uniform(glUniform1f, effect.thickness, asset == EFFECT_ASSET_ID::RECTANGLE ? 6 : 4);
 
 	// Setup coloring
 	vec4 color = vec4(1);
@@ -715,12 +697,8 @@ void RenderSystem::draw_rectangle(EFFECT_ASSET_ID asset, Entity entity, Transfor
 		fill_color = rect.fill_color;
 	}
 
-	GLint fill_color_uloc = glGetUniformLocation(program, "fcolor_fill");
-	glUniform4fv(fill_color_uloc, 1, glm::value_ptr(fill_color));
-	gl_has_errors();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	glUniform4fv(color_uloc, 1, glm::value_ptr(color));
+	upload_uniform(glUniform4fv, effect.fcolor_fill, 1, glm::value_ptr(fill_color));
+	upload_uniform(glUniform4fv, effect.fcolor, 1, glm::value_ptr(color));
 	gl_has_errors();
 
 	draw_triangles(transform, projection);
@@ -734,48 +712,67 @@ void RenderSystem::draw_text(Entity entity, const Text& text, const mat3& projec
 
 	Transform transform = get_transform(entity);
 
-	const auto program = (GLuint)effects.at((text.border > 0) ? (uint8)EFFECT_ASSET_ID::TEXT_BUBBLE : (uint8)EFFECT_ASSET_ID::TEXTURED);
-
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
+	const EffectInterface& effect
+		= use_effect((text.border > 0) ? EFFECT_ASSET_ID::TEXT_BUBBLE : EFFECT_ASSET_ID::TEXTURED);
 
-	auto text_data = text_buffers.find(text);
-
-	if (text_data == text_buffers.end()) {
-		TextData new_text_data = generate_text(text, registry.any_of<Cursive>(entity));
-		text_data = text_buffers.emplace(text, new_text_data).first;
+	vec2 text_size;
+	GLuint texture = 0;
+	if (text.border > 0) {
+		// The bubble shader draws its border around the edges of the texture, so bordered text keeps one of its own
+		TextData* text_data = text_buffers.find(text);
+		if (text_data == nullptr) {
+			TextData new_text_data = generate_text(text, registry.any_of<Cursive>(entity));
+			size_t bytes = static_cast<size_t>(new_text_data.texture_width) * new_text_data.texture_height * 4;
+			text_data = &text_buffers.insert(text, new_text_data, bytes);
+		}
+		text_size = vec2(text_data->texture_width, text_data->texture_height) + 2.f * static_cast<float>(text.border);
+		texture = text_data->texture;
+		bind_geometry(GEOMETRY_BUFFER_ID::SPRITE);
+	} else {
+		// Everything else is a quad per glyph, so text that changes every frame never needs a new texture
+		const GlyphAtlas& atlas = get_glyph_atlas(registry.any_of<Cursive>(entity), text.font_size);
+		text_vertices.clear();
+		text_indices.clear();
+		text_size = atlas.layout(text.text, static_cast<int>(screen_size.x), text_vertices, text_indices);
+		if (text_indices.empty()) {
+			return;
+		}
+		texture = atlas.get_texture();
+
+		bind_geometry(GEOMETRY_BUFFER_ID::TEXT_GLYPHS);
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers.at((int)GEOMETRY_BUFFER_ID::TEXT_GLYPHS));
+		glBufferData(GL_ARRAY_BUFFER,
+					 static_cast<GLsizeiptr>(sizeof(TexturedVertex) * text_vertices.size()),
+					 text_vertices.data(),
+					 GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers.at((int)GEOMETRY_BUFFER_ID::TEXT_GLYPHS));
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+					 static_cast<GLsizeiptr>(sizeof(uint16_t) * text_indices.size()),
+					 text_indices.data(),
+					 GL_DYNAMIC_DRAW);
+		index_counts.at((int)GEOMETRY_BUFFER_ID::TEXT_GLYPHS) = static_cast<GLsizei>(text_indices.size());
+		gl_has_errors();
 	}
 
 	// Scale to expected pixel size, apply screen scale so not affected by zoom
-	vec2 text_size = vec2(text_data->second.texture_width, text_data->second.texture_height) + 2.f * static_cast<float>(text.border);
 	transform.scale(text_size * screen_scale
 					* get_ui_scale_factor());
 
 	// Shift according to desired alignment using fancy enum wizardry
 	transform.translate({ (float)text.alignment_x * .5, (float)text.alignment_y * .5 });
 
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::SPRITE);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::SPRITE);
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	prepare_for_textured(text_data->second.texture);
+	prepare_for_textured(texture);
 
 	// Setup coloring
 	if (registry.any_of<Color>(entity)) {
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
 		const vec3 color = registry.get<Color>(entity).color;
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
 		gl_has_errors();
 	}
 
 	if (text.border > 0) {
-		GLint border_uloc = glGetUniformLocation(program, "fborder");
-		glUniform1ui(border_uloc, static_cast<GLuint>(text.border));
+		upload_uniform(glUniform1ui, effect.fborder, static_cast<GLuint>(text.border));
 		gl_has_errors();
 	}
 
@@ -788,43 +785,16 @@ void RenderSystem::draw_line(Entity entity, const Line& line, const mat3& projec
 	transform.rotate(line.angle);
 	transform.scale(line.scale);
 
-	const auto program = (GLuint)effects.at((uint8)EFFECT_ASSET_ID::LINE);
-
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::DEBUG_LINE);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::DEBUG_LINE);
+	const EffectInterface& effect = use_effect(EFFECT_ASSET_ID::LINE);
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	GLint in_color_loc = glGetAttribLocation(program, "in_color");
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_color_loc);
-	glVertexAttribPointer(
-		in_color_loc,
-		3,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(ColoredVertex),
-		((void*)sizeof(vec3))); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-	gl_has_errors();
+	bind_geometry(GEOMETRY_BUFFER_ID::DEBUG_LINE);
 
 	// Setup coloring
 	if (registry.any_of<Color>(entity)) {
-		GLint color_uloc = glGetUniformLocation(program, "fcolor");
 		const vec3 color = registry.get<Color>(entity).color;
-		glUniform3fv(color_uloc, 1, glm::value_ptr(color));
+		upload_uniform(glUniform3fv, effect.fcolor, 1, glm::value_ptr(color));
 		gl_has_errors();
 	}
 
@@ -833,95 +803,254 @@ void RenderSystem::draw_line(Entity entity, const Line& line, const mat3& projec
 
 void RenderSystem::draw_map(const mat3& projection, ColorState color)
 {
-	const auto program = (GLuint)effects.at((uint8)EFFECT_ASSET_ID::TILE_MAP);
-	gl_has_errors();
+	TEXTURE_ASSET_ID tile_set
+		= (color == ColorState::Blue) ? TEXTURE_ASSET_ID::TILE_SET_BLUE : TEXTURE_ASSET_ID::TILE_SET_RED;
+	if (use_level_tile_map) {
+		update_level_tile_map();
+		draw_level_tile_map(projection, tile_set);
+	} else {
+		draw_map_by_room(projection, tile_set);
+	}
+}
 
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::ROOM);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::ROOM);
+void RenderSystem::draw_map_by_room(const mat3& projection, TEXTURE_ASSET_ID tile_set)
+{
+	const EffectInterface& effect = use_effect(EFFECT_ASSET_ID::TILE_MAP);
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
+	bind_geometry(GEOMETRY_BUFFER_ID::ROOM);
 
-	glUseProgram(program);
-
-	glActiveTexture(GL_TEXTURE0);
-	gl_has_errors();
-	TEXTURE_ASSET_ID tex
-		= (color == ColorState::Blue) ? TEXTURE_ASSET_ID::TILE_SET_BLUE : TEXTURE_ASSET_ID::TILE_SET_RED;
-	GLuint texture_id = texture_gl_handles.at((GLuint)tex);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	gl_has_errors();
+	bind_texture(0, texture_gl_handles.at((GLuint)tile_set));
 	for (auto [entity, room] : registry.view<Room>().each()) {
-		if (use_lighting && !room.visible) {
+		if ((use_lighting && !room.visible) || !room_in_view(room.room_index)) {
 			continue;
 		}
 
 		Transform transform = get_transform(entity);
-		transform.scale(scaling_factors.at(static_cast<int>(tex)));
+		transform.scale(scaling_factors.at(static_cast<int>(tile_set)));
 
 		const auto& room_layout = map_generator->get_room_layout(room.level, room.room_id);
-		GLint room_layout_loc = glGetUniformLocation(program, "room_layout");
-		glUniform1uiv(room_layout_loc, (GLsizei)room_layout.size(), room_layout.data());
-
-		GLint vertex_id_loc = glGetAttribLocation(program, "cur_vertex_id");
-		glEnableVertexAttribArray(vertex_id_loc);
-		glVertexAttribIPointer(vertex_id_loc, 1, GL_INT, sizeof(int), nullptr);
+		upload_uniform(glUniform1uiv, effect.room_layout, (GLsizei)room_layout.size(), room_layout.data());
 		gl_has_errors();
 
 		Animation& animation = registry.get<Animation>(entity);
 		assert(registry.any_of<Animation>(entity));
 
-		GLint frame_loc = glGetUniformLocation(program, "frame");
-		glUniform1i(frame_loc, animation.frame);
+		upload_uniform(glUniform1i, effect.frame, animation.frame);
 
-		GLint appearing_loc = glGetUniformLocation(program, "appearing");
 		bool appearing = false;
 		if (RoomAnimation* appear = registry.try_get<RoomAnimation>(entity)) {
-			GLint start_tile = glGetUniformLocation(program, "start_tile");
-			glUniform2fv(start_tile, 1, glm::value_ptr(MapUtility::map_position_to_world_position(appear->start_tile)));
-
-			GLint max_show_distance = glGetUniformLocation(program, "max_show_distance");
-			glUniform1f(max_show_distance, appear->dist_per_second * (appear->elapsed_time / 1000.f));
+			upload_uniform(glUniform2fv, effect.start_tile, 1, glm::value_ptr(MapUtility::map_position_to_world_position(appear->start_tile)));
+			upload_uniform(glUniform1f, effect.max_show_distance, appear->dist_per_second * (appear->elapsed_time / 1000.f));
 			appearing = true;
 		}
-		glUniform1i(appearing_loc, static_cast<int>(appearing));
+		upload_uniform(glUniform1i, effect.appearing, static_cast<int>(appearing));
 
 		draw_triangles(transform, projection);
 	}
 }
 
+void RenderSystem::update_visible_rooms()
+{
+	static constexpr float room_extent = MapUtility::tile_size * MapUtility::room_size;
+	vec2 top_left;
+	vec2 bottom_right;
+	std::tie(top_left, bottom_right) = get_window_bounds();
+	vec2 margin = vec2(cull_margin_tiles * MapUtility::tile_size);
+	ivec2 first_room = glm::clamp(ivec2(glm::floor((top_left - margin - MapUtility::top_left_corner) / room_extent)),
+								  ivec2(0),
+								  ivec2(MapUtility::map_size - 1));
+	ivec2 last_room = glm::clamp(ivec2(glm::floor((bottom_right + margin - MapUtility::top_left_corner) / room_extent)),
+								 ivec2(0),
+								 ivec2(MapUtility::map_size - 1));
+
+	visible_rooms.fill(false);
+	for (int y = first_room.y; y <= last_room.y; y++) {
+		for (int x = first_room.x; x <= last_room.x; x++) {
+			visible_rooms.at(x + y * MapUtility::map_size) = true;
+		}
+	}
+}
+
+bool RenderSystem::room_in_view(uint8_t room_index)
+{
+	bool visible = visible_rooms.at(room_index);
+	if (visible) {
+		frame_stats.in_view++;
+	} else {
+		frame_stats.culled++;
+	}
+	return visible;
+}
+
+bool RenderSystem::in_view(Entity entity)
+{
+	ivec2 tile;
+	if (const WorldPosition* world_pos = registry.try_get<WorldPosition>(entity)) {
+		tile = ivec2(glm::floor((world_pos->position - MapUtility::top_left_corner) / MapUtility::tile_size));
+	} else if (const MapPosition* map_pos = registry.try_get<MapPosition>(entity)) {
+		tile = ivec2(map_pos->position);
+	} else {
+		// Screen space, always in view
+		return true;
+	}
+
+	static constexpr int level_tiles = MapUtility::map_size * MapUtility::room_size;
+	if (tile.x < 0 || tile.y < 0 || tile.x >= level_tiles || tile.y >= level_tiles) {
+		// Off the map, so not in any room, don't risk hiding it
+		return true;
+	}
+	return room_in_view(MapUtility::get_room_index(uvec2(tile)));
+}
+
+void RenderSystem::update_level_tile_map()
+{
+	int level = map_generator->get_current_level();
+	unsigned int version = map_generator->get_tile_version();
+	unsigned int generation = map_generator->get_layout_generation();
+	if (level != level_tile_map_level || version != level_tile_map_version
+		|| generation != level_tile_map_generation) {
+		std::vector<uint8_t> tile_ids(static_cast<size_t>(level_tiles) * level_tiles);
+		const MapUtility::MapLayout& map_layout = map_generator->current_map();
+		for (uint row = 0; row < level_tiles; row++) {
+			for (uint col = 0; col < level_tiles; col++) {
+				MapUtility::RoomID room_id
+					= map_layout.at(row / MapUtility::room_size).at(col / MapUtility::room_size);
+				tile_ids.at(row * level_tiles + col) = static_cast<uint8_t>(map_generator->get_tile_id_from_room(
+					level, room_id, row % MapUtility::room_size, col % MapUtility::room_size));
+			}
+		}
+		bind_texture(0, level_tile_texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(
+			GL_TEXTURE_2D, 0, 0, 0, level_tiles, level_tiles, GL_RED_INTEGER, GL_UNSIGNED_BYTE, tile_ids.data());
+		gl_has_errors();
+		level_tile_map_level = level;
+		level_tile_map_version = version;
+		level_tile_map_generation = generation;
+	}
+
+	// Rooms that aren't revealing themselves are shown in full
+	room_states.fill(vec4(0, 0, std::numeric_limits<float>::max(), 0));
+	for (auto [entity, room] : registry.view<Room>().each()) {
+		vec4& state = room_states.at(room.room_index);
+		state.w = (!use_lighting || room.visible) ? 1.f : 0.f;
+		if (RoomAnimation* appear = registry.try_get<RoomAnimation>(entity)) {
+			vec2 start = MapUtility::map_position_to_world_position(appear->start_tile);
+			state = vec4(start, appear->dist_per_second * (appear->elapsed_time / 1000.f), state.w);
+		}
+	}
+	bind_texture(0, room_state_texture);
+	glTexSubImage2D(
+		GL_TEXTURE_2D, 0, 0, 0, MapUtility::map_size, MapUtility::map_size, GL_RGBA, GL_FLOAT, room_states.data());
+	gl_has_errors();
+}
+
+void RenderSystem::draw_level_tile_map(const mat3& projection, TEXTURE_ASSET_ID tile_set)
+{
+	// Only the tiles overlapping the camera are drawn
+	vec2 top_left, bottom_right;
+	std::tie(top_left, bottom_right) = get_window_bounds();
+	ivec2 first_tile = glm::clamp(ivec2(glm::floor((top_left - MapUtility::top_left_corner) / MapUtility::tile_size)),
+								  ivec2(0),
+								  ivec2(level_tiles));
+	ivec2 last_tile = glm::clamp(ivec2(glm::ceil((bottom_right - MapUtility::top_left_corner) / MapUtility::tile_size)),
+								 ivec2(0),
+								 ivec2(level_tiles));
+	ivec2 tiles = last_tile - first_tile;
+	if (tiles.x <= 0 || tiles.y <= 0) {
+		return;
+	}
+
+	const EffectInterface& effect = use_effect(EFFECT_ASSET_ID::LEVEL_TILE_MAP);
+	// No vertex data, the shader builds every tile from gl_VertexID
+	bind_vertex_array(level_tile_map_vertex_array);
+	current_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+
+	bind_texture(0, texture_gl_handles.at((GLuint)tile_set));
+	bind_texture(1, level_tile_texture);
+	bind_texture(2, room_state_texture);
+	gl_has_errors();
+
+	upload_uniform(glUniformMatrix3fv, effect.projection, 1, GL_FALSE, glm::value_ptr(projection));
+	upload_uniform(glUniform2iv, effect.tile_origin, 1, glm::value_ptr(first_tile));
+	upload_uniform(glUniform1i, effect.tile_columns, tiles.x);
+	upload_uniform(glUniform2fv, effect.map_top_left, 1, glm::value_ptr(MapUtility::top_left_corner));
+	upload_uniform(glUniform1f, effect.tile_size, MapUtility::tile_size);
+	gl_has_errors();
+
+	frame_stats.draws++;
+	glDrawArrays(GL_TRIANGLES, 0, tiles.x * tiles.y * 6);
+	gl_has_errors();
+}
+
 void RenderSystem::toggle_lighting() { use_lighting = !use_lighting; }
 
 void RenderSystem::set_lighting(bool enabled) { use_lighting = enabled; }
 
-void RenderSystem::prepare_for_lit_entity(GLuint program) const
+void RenderSystem::prepare_for_lit_entity(const EffectInterface& effect)
 {
+	// Samplers are bound to their texture units when the effect is loaded
+	upload_uniform(glUniform1i, effect.use_lighting, static_cast<int>(applying_lighting));
 
-	// Bind our textures in
-	GLint texture_loc = glGetUniformLocation(program, "sampler0");
-	GLint lighting_texture_loc = glGetUniformLocation(program, "lighting");
-	GLint use_lighting_loc = glGetUniformLocation(program, "use_lighting");
-	glUniform1i(texture_loc, 0);
-	glUniform1i(lighting_texture_loc, 1);
-	glUniform1i(use_lighting_loc, static_cast<int>(applying_lighting));
-
-	glActiveTexture(GL_TEXTURE0 + 1);
-	glBindTexture(GL_TEXTURE_2D, lighting_buffer_color);
+	bind_texture(1, lighting_buffer_color);
 }
 
 void RenderSystem::create_lighting_texture(const mat3& projection)
 {
 	glBindFramebuffer(GL_FRAMEBUFFER, lighting_frame_buffer);
 	gl_has_errors();
-	prepare_buffer(vec3(0));
+	prepare_buffer(vec3(0), get_lighting_buffer_size());
 
+	update_light_masks();
 	for (auto [entity, light] : registry.view<Light>().each()) {
 		draw_light(entity, light, projection);
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	glViewport(0, 0, (GLsizei)screen_size_capped().x, (GLsizei)screen_size_capped().y);
+}
+
+void RenderSystem::update_light_masks()
+{
+	for (LightMaskBuffer& buffer : light_mask_buffers) {
+		unsigned int version
+			= buffer.static_lights ? lighting.get_static_mask_version() : lighting.get_dynamic_mask_version();
+		if (buffer.version == version) {
+			continue;
+		}
+		buffer.version = version;
+
+		buffer.ranges.clear();
+		std::vector<ColoredVertex> mask_vertices;
+		for (auto [entity, light, mask] : registry.view<Light, LightMask>().each()) {
+			if (registry.all_of<StaticLight>(entity) != buffer.static_lights) {
+				continue;
+			}
+			// The light shader works in the light's local space, where the light covers [-.5, .5], taken about the
+			// tile the mask was computed from so it still lines up with the walls once the light stops
+			vec2 light_center = MapUtility::map_position_to_world_position(mask.origin);
+			float half_tile = MapUtility::tile_size / 2.f / (2.f * light.radius);
+			buffer.ranges[entity]
+				= { static_cast<GLint>(mask_vertices.size()), static_cast<GLsizei>(mask.tiles.size() * 6) };
+			for (const uvec2& tile : mask.tiles) {
+				vec2 center = (MapUtility::map_position_to_world_position(tile) - light_center) / (2.f * light.radius);
+				vec3 top_left = vec3(center - half_tile, 0.8f);
+				vec3 bottom_right = vec3(center + half_tile, 0.8f);
+				vec3 top_right = vec3(bottom_right.x, top_left.y, 0.8f);
+				vec3 bottom_left = vec3(top_left.x, bottom_right.y, 0.8f);
+				for (const vec3& corner : { top_left, bottom_left, top_right, top_right, bottom_left, bottom_right }) {
+					mask_vertices.push_back({ corner, vec3(1) });
+				}
+			}
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers.at((int)buffer.geometry));
+		glBufferData(GL_ARRAY_BUFFER,
+					 static_cast<GLsizeiptr>(sizeof(ColoredVertex) * mask_vertices.size()),
+					 mask_vertices.data(),
+					 GL_DYNAMIC_DRAW);
+		gl_has_errors();
+	}
 }
 
 void RenderSystem::draw_light(Entity entity, const Light& light, const mat3& projection)
@@ -929,39 +1058,15 @@ void RenderSystem::draw_light(Entity entity, const Light& light, const mat3& pro
 	Transform transform = get_transform(entity);
 
 	transform.scale(vec2(2) * light.radius);
-	const auto program = (GLuint)effects.at((uint8)EFFECT_ASSET_ID::LIGHT);
 
 	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
-
-	const GLuint vbo = vertex_buffers.at((int)GEOMETRY_BUFFER_ID::LINE);
-	const GLuint ibo = index_buffers.at((int)GEOMETRY_BUFFER_ID::LINE);
+	const EffectInterface& effect = use_effect(EFFECT_ASSET_ID::LIGHT);
 
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	gl_has_errors();
-
-	GLint in_color_loc = glGetAttribLocation(program, "in_color");
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
-	gl_has_errors();
-
-	glEnableVertexAttribArray(in_color_loc);
-	glVertexAttribPointer(
-		in_color_loc,
-		3,
-		GL_FLOAT,
-		GL_FALSE,
-		sizeof(ColoredVertex),
-		(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
-	gl_has_errors();
+	// Occluded lights only cover the tiles in their mask, otherwise the light is a single quad
+	const LightMaskBuffer& buffer = light_mask_buffers.at(registry.all_of<StaticLight>(entity) ? 0 : 1);
+	auto mask = buffer.ranges.find(entity);
+	bool masked = mask != buffer.ranges.end() && registry.all_of<LightMask>(entity);
+	bind_geometry(masked ? buffer.geometry : GEOMETRY_BUFFER_ID::LINE);
 
 	// Setup coloring
 	vec4 color = vec4(1);
@@ -969,10 +1074,18 @@ void RenderSystem::draw_light(Entity entity, const Light& light, const mat3& pro
 		color = vec4(registry.get<Color>(entity).color, 1.f);
 	}
 
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	glUniform4fv(color_uloc, 1, glm::value_ptr(color));
+	upload_uniform(glUniform4fv, effect.fcolor, 1, glm::value_ptr(color));
 	gl_has_errors();
 
+	if (masked) {
+		upload_uniform(glUniformMatrix3fv, effect.transform, 1, GL_FALSE, glm::value_ptr(transform.mat));
+		upload_uniform(glUniformMatrix3fv, effect.projection, 1, GL_FALSE, glm::value_ptr(projection));
+		frame_stats.draws++;
+		glDrawArrays(GL_TRIANGLES, mask->second.first, mask->second.count);
+		gl_has_errors();
+		return;
+	}
+
 	draw_triangles(transform, projection);
 }
 
@@ -981,12 +1094,7 @@ void RenderSystem::draw_lighting(const mat3& projection)
 
 	glBindFramebuffer(GL_FRAMEBUFFER, los_frame_buffer);
 	gl_has_errors();
-	prepare_buffer(vec3(0));
-
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers.at((int)GEOMETRY_BUFFER_ID::LIGHTING_TRIANGLES));
-
-	auto program = (GLuint)effects.at((uint8)EFFECT_ASSET_ID::LIGHT_TRIANGLES);
-	gl_has_errors();
+	prepare_buffer(vec3(0), get_lighting_buffer_size());
 
 	std::vector<GLfloat> vertices;
 	for (auto [entity, request] : registry.view<LightingTriangle>().each()) {
@@ -1001,20 +1109,18 @@ void RenderSystem::draw_lighting(const mat3& projection)
 		}
 	}
 
+	const EffectInterface& triangles_effect = use_effect(EFFECT_ASSET_ID::LIGHT_TRIANGLES);
+	bind_geometry(GEOMETRY_BUFFER_ID::LIGHTING_TRIANGLES);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers.at((int)GEOMETRY_BUFFER_ID::LIGHTING_TRIANGLES));
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_DYNAMIC_DRAW);
+	gl_has_errors();
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-	glUseProgram(program);
-
-	GLint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
+	upload_uniform(glUniformMatrix3fv, triangles_effect.projection, 1, GL_FALSE, glm::value_ptr(projection));
 	gl_has_errors();
 
+	frame_stats.draws++;
 	glDrawArrays(GL_TRIANGLES, 0, vertices.size() / 2);
 	gl_has_errors();
-	glDisableVertexAttribArray(0);
 
 	for (auto [entity] : registry.view<LightingTile>().each()) {
 		Transform transform = get_transform(entity);
@@ -1023,50 +1129,26 @@ void RenderSystem::draw_lighting(const mat3& projection)
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	glViewport(0, 0, (GLsizei)screen_size_capped().x, (GLsizei)screen_size_capped().y);
 
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	gl_has_errors();
+	// Apply Lighting, the lighting and line of sight buffers are upsampled by their linear filtering
+	use_effect(EFFECT_ASSET_ID::LIGHTING);
 
-	// Apply Lighting
-	program = (GLuint)effects.at((uint8)EFFECT_ASSET_ID::LIGHTING);
+	// Draw the screen texture on the quad geometry
+	bind_geometry(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE);
 
-	// Setting shaders
-	glUseProgram(program);
+	// Bind our textures in, the samplers were pointed at these units when the effect was loaded
+	bind_texture(0, off_screen_render_buffer_color);
 	gl_has_errors();
 
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), nullptr);
+	bind_texture(1, lighting_buffer_color);
 	gl_has_errors();
 
-	// Bind our textures in
-	GLint screen_texture_loc = glGetUniformLocation(program, "screen");
-	GLint lighting_texture_loc = glGetUniformLocation(program, "lighting");
-	GLint los_texture_loc = glGetUniformLocation(program, "los");
-	glUniform1i(screen_texture_loc, 0);
-	glUniform1i(lighting_texture_loc, 1);
-	glUniform1i(los_texture_loc, 2);
-
-	glActiveTexture(GL_TEXTURE0);
-	gl_has_errors();
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
-	gl_has_errors();
-
-	glActiveTexture(GL_TEXTURE0 + 1);
-	glBindTexture(GL_TEXTURE_2D, lighting_buffer_color);
-	gl_has_errors();
-
-	glActiveTexture(GL_TEXTURE0 + 2);
-	glBindTexture(GL_TEXTURE_2D, los_buffer_color);
+	bind_texture(2, los_buffer_color);
 	gl_has_errors();
 
 	// Draw
+	frame_stats.draws++;
 	glDrawElements(GL_TRIANGLES,
 				   3,
 				   GL_UNSIGNED_SHORT,
@@ -1076,23 +1158,15 @@ void RenderSystem::draw_lighting(const mat3& projection)
 }
 void RenderSystem::draw_triangles(const Transform& transform, const mat3& projection)
 {
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
+	const EffectInterface& effect = effect_interfaces.at((GLuint)current_effect);
 
-	auto num_indices = static_cast<GLsizei>(size / sizeof(uint16_t));
-
-	GLint curr_program = 0;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &curr_program);
 	// Setting uniform values to the currently bound program
-	GLint transform_loc = glGetUniformLocation(curr_program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, glm::value_ptr(transform.mat));
-	GLint projection_loc = glGetUniformLocation(curr_program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
+	upload_uniform(glUniformMatrix3fv, effect.transform, 1, GL_FALSE, glm::value_ptr(transform.mat));
+	upload_uniform(glUniformMatrix3fv, effect.projection, 1, GL_FALSE, glm::value_ptr(projection));
 	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	frame_stats.draws++;
+	glDrawElements(GL_TRIANGLES, index_counts.at((GLuint)current_geometry), GL_UNSIGNED_SHORT, nullptr);
 	gl_has_errors();
 }
 
@@ -1102,8 +1176,7 @@ void RenderSystem::draw_to_screen()
 {
 	// Setting shaders
 	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
+	const EffectInterface& effect = use_effect(EFFECT_ASSET_ID::WATER);
 	// Clearing backbuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, (GLsizei)screen_size.x, (GLsizei)screen_size.y);
@@ -1114,32 +1187,19 @@ void RenderSystem::draw_to_screen()
 	gl_has_errors();
 
 	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-																	 // indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
+	bind_geometry(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE);
+
 	// Set clock
-	GLint time_uloc = glGetUniformLocation(water_program, "time");
-	GLint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+	upload_uniform(glUniform1f, effect.time, (float)(glfwGetTime() * 10.0f));
 	ScreenState& screen = registry.get<ScreenState>(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), nullptr);
+	upload_uniform(glUniform1f, effect.darken_screen_factor, screen.darken_screen_factor);
 	gl_has_errors();
 
 	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	bind_texture(0, off_screen_render_buffer_color);
 	gl_has_errors();
 	// Draw
+	frame_stats.draws++;
 	glDrawElements(GL_TRIANGLES,
 				   3,
 				   GL_UNSIGNED_SHORT,
@@ -1150,6 +1210,47 @@ void RenderSystem::draw_to_screen()
 
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
+void RenderSystem::queue_render_command(RenderLayer layer,
+										EFFECT_ASSET_ID effect,
+										TEXTURE_ASSET_ID texture,
+										GEOMETRY_BUFFER_ID geometry,
+										Entity entity)
+{
+	// Depth keeps commands that share all their state in the order they were queued
+	uint64_t depth = static_cast<uint64_t>(render_queue.size()) & 0xffffff;
+	RenderCommand& command = render_queue.emplace_back();
+	command.key = (static_cast<uint64_t>(layer) << 56) | (static_cast<uint64_t>(effect) << 48)
+		| (static_cast<uint64_t>(texture) << 32) | (static_cast<uint64_t>(geometry) << 24) | depth;
+	command.layer = layer;
+	command.entity = entity;
+}
+
+void RenderSystem::submit_render_queue(const mat3& projection)
+{
+	std::sort(render_queue.begin(), render_queue.end(), [](const RenderCommand& a, const RenderCommand& b) {
+		return a.key < b.key;
+	});
+	frame_stats.commands += static_cast<uint>(render_queue.size());
+
+	for (const RenderCommand& command : render_queue) {
+		switch (command.layer) {
+		case RenderLayer::Meshes:
+			draw_textured_mesh(command.entity, registry.get<RenderRequest>(command.entity), projection);
+			break;
+		case RenderLayer::SpriteBatches:
+			draw_instance_batches(sprite_batches, projection);
+			break;
+		case RenderLayer::Overlays:
+			draw_instance_batches(overlay_batches, projection);
+			break;
+		case RenderLayer::Effects:
+			draw_effect(command.entity, registry.get<EffectRenderRequest>(command.entity), projection);
+			break;
+		}
+	}
+	render_queue.clear();
+}
+
 void RenderSystem::draw()
 {
 	// Grabs player's perception of which colour is "inactive"
@@ -1160,12 +1261,16 @@ void RenderSystem::draw()
 	// Reset lighting state
 	applying_lighting = false;
 
+	frame_stats = FrameStats();
+	reset_bind_cache();
+
 	// First render to the custom framebuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
 	gl_has_errors();
 	prepare_buffer((inactive_color == ColorState::Blue) ? vec3(7.f / 256, 6.f / 256, 6.f / 256)
 														: vec3(7.f / 256, 6.f / 256, 6.f / 256));
 	mat3 projection_2d = create_projection_matrix();
+	update_visible_rooms();
 
 	draw_map(projection_2d, inactive_color == ColorState::Blue ? ColorState::Red : ColorState::Blue);
 
@@ -1183,48 +1288,31 @@ void RenderSystem::draw()
 	}
 
 	auto render_requests_lambda = [&](Entity entity, RenderRequest& render_request) {
-		if (render_request.visible) {
-			draw_textured_mesh(entity, render_request, projection_2d);
+		if (!render_request.visible || !in_view(entity)) {
+			return;
+		}
+		if (!batch_sprite(entity, render_request)) {
+			queue_render_command(RenderLayer::Meshes,
+								 render_request.used_effect,
+								 render_request.used_texture,
+								 render_request.used_geometry,
+								 entity);
 		}
 	};
 
 	auto health_group_lambda = [&](Entity entity, RenderRequest& request, Stats& stats, Enemy& /*enemy*/) {
-		if (!request.visible) {
-			return;
+		if (request.visible && in_view(entity)) {
+			batch_health_bar(entity, stats);
 		}
-		uvec2 tile;
-		Transform transform = get_transform(entity, &tile);
-		if (!lighting.is_visible(tile)) {
-			return;
-		}
-		vec2 shift = vec2(2 - MapUtility::tile_size / 2, -MapUtility::tile_size / 2);
-		vec2 scale = vec2(MapUtility::tile_size - 4, 3);
-		bool fancy = false;
-		if (MapHitbox* hitbox = registry.try_get<MapHitbox>(entity)) {
-			shift.x -= MapUtility::tile_size * hitbox->center.x;
-			shift.y -= MapUtility::tile_size * hitbox->center.y;
-			scale.x = MapUtility::tile_size * hitbox->area.x - 4;
-			scale.y = min(9.f, hitbox->area.x * scale.y);
-			fancy = true;
-		}
-		transform.translate(shift);
-		transform.scale(scale);
-		draw_stat_bar(transform, stats, projection_2d, fancy, scale.x / scale.y, entity);
 	};
 
 	auto combat_conditions_lambda = [&](Entity entity, RenderRequest& combat_entity_render, ActiveConditions& combat_conditions) {
-		if (combat_entity_render.visible) {
-			float condition_offset = 0.f;
-			for (size_t condition_index = 0; condition_index < num_conditions; condition_index++) {
-				if (combat_conditions.conditions.at(condition_index) != 0) {
-					draw_condition(entity, condition_index, condition_offset, projection_2d);
-					condition_offset += 1.f;
-				}
-			}
+		if (combat_entity_render.visible && in_view(entity)) {
+			batch_conditions(entity, combat_conditions);
 		}
 	};
 
-	// Renders entities + healthbars depending on which state we are in
+	// Queues entities + healthbars depending on which state we are in
 	if (inactive_color == ColorState::Red) {
 		registry.view<RenderRequest>(entt::exclude<Background, RedExclusive>).each(render_requests_lambda);
 		registry.view<RenderRequest, Stats, Enemy>(entt::exclude<RedExclusive>).each(health_group_lambda);
@@ -1238,17 +1326,27 @@ void RenderSystem::draw()
 		registry.view<RenderRequest, Stats, Enemy>().each(health_group_lambda);
 		registry.view<RenderRequest, ActiveConditions>().each(combat_conditions_lambda);
 	}
+	// Every batched sprite and overlay was queued above, so they can all go in a single command each
+	for (RenderLayer layer : { RenderLayer::SpriteBatches, RenderLayer::Overlays }) {
+		queue_render_command(layer,
+							 EFFECT_ASSET_ID::EFFECT_COUNT,
+							 TEXTURE_ASSET_ID::TEXTURE_COUNT,
+							 GEOMETRY_BUFFER_ID::GEOMETRY_COUNT,
+							 entt::null);
+	}
 
-	// Renders effects (ie spells), intended to be overlayed on top of regular render effects
+	// Effects (ie spells) are intended to be overlayed on top of regular render effects
 	for (auto [entity, effect_render_request] : registry.view<EffectRenderRequest>().each()) {
-		// Note, its not very efficient to access elements indirectly via the entity
-		// albeit iterating through all Sprites in sequence. A good point to optimize
-		if (effect_render_request.visible) {
-			draw_effect(entity, effect_render_request, projection_2d);
+		if (effect_render_request.visible && in_view(entity)) {
+			queue_render_command(RenderLayer::Effects,
+								 effect_render_request.used_effect,
+								 effect_render_request.used_texture,
+								 effect_render_request.used_geometry,
+								 entity);
 		}
 	}
 
-
+	submit_render_queue(projection_2d);
 
 	if (use_lighting) {
 		draw_lighting(projection_2d);
@@ -1262,8 +1360,10 @@ void RenderSystem::draw()
 	// Truely render to the screen
 	draw_to_screen();
 
-	// flicker-free display with a double buffer
-	glfwSwapBuffers(window);
+	// flicker-free display with a double buffer, there's nothing to present to when recording headless
+	if (window != nullptr) {
+		glfwSwapBuffers(window);
+	}
 	gl_has_errors();
 }
 
@@ -1305,7 +1405,29 @@ void RenderSystem::draw_ui(const mat3& projection)
 	for (auto [entity, line] : registry.view<Line>(entt::exclude<UIElement>).each()) {
 		draw_line(entity, line, projection);
 	}
+
+#ifdef ENABLE_PROFILER
+	if (debugging.show_profiler) {
+		draw_profiler_overlay(projection);
+	}
+#endif
+}
+
+#ifdef ENABLE_PROFILER
+void RenderSystem::draw_profiler_overlay(const mat3& projection)
+{
+	if (!registry.valid(profiler_overlay)) {
+		profiler_overlay = registry.create();
+		registry.emplace<ScreenPosition>(profiler_overlay, vec2(.01f, .01f));
+		registry.emplace<Color>(profiler_overlay, vec3(1.f));
+		registry.emplace<Text>(profiler_overlay, "", static_cast<uint16>(24), Alignment::Start, Alignment::Start);
+	}
+	// Glyph atlas text, so a new string every frame costs no textures
+	Text& text = registry.get<Text>(profiler_overlay);
+	text.text = Profiler::current().summary();
+	draw_text(profiler_overlay, text, projection);
 }
+#endif
 
 // projection matrix based on position of camera entity
 mat3 RenderSystem::create_projection_matrix()
@@ -1393,29 +1515,19 @@ void RenderSystem::on_resize(int width, int height)
 				 nullptr);
 	gl_has_errors();
 
-	glBindTexture(GL_TEXTURE_2D, lighting_buffer_color);
-	glTexImage2D(GL_TEXTURE_2D,
-				 0,
-				 GL_RGBA,
-				 (GLsizei)screen_size_capped().x,
-				 (GLsizei)screen_size_capped().y,
-				 0,
-				 GL_RGBA,
-				 GL_UNSIGNED_BYTE,
-				 nullptr);
-	gl_has_errors();
+	resize_lighting_buffers();
+}
 
-	glBindTexture(GL_TEXTURE_2D, los_buffer_color);
-	glTexImage2D(GL_TEXTURE_2D,
-				 0,
-				 GL_RGBA,
-				 (GLsizei)screen_size_capped().x,
-				 (GLsizei)screen_size_capped().y,
-				 0,
-				 GL_RGBA,
-				 GL_UNSIGNED_BYTE,
-				 nullptr);
-	gl_has_errors();
+void RenderSystem::set_lighting_downscale(uint downscale)
+{
+	assert(downscale > 0);
+	lighting_downscale = downscale;
+	resize_lighting_buffers();
+}
+
+ivec2 RenderSystem::get_lighting_buffer_size() const
+{
+	return max(ivec2(screen_size_capped()) / static_cast<int>(lighting_downscale), ivec2(1));
 }
 
 // update camera's map position when player move out of buffer
@@ -1,15 +1,21 @@
 #pragma once
 
 #include <array>
+#include <limits>
+#include <map>
+#include <unordered_map>
 #include <utility>
 #define SDL_MAIN_HANDLED
 #include <SDL_ttf.h>
 
 #include "common.hpp"
 #include "components.hpp"
+#include "glyph_atlas.hpp"
+#include "lru_cache.hpp"
 
 #include "lighting_system.hpp"
 #include "map_generator_system.hpp"
+#include "recording_gl_backend.hpp"
 
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
@@ -73,6 +79,42 @@ class RenderSystem {
 	};
 
 	std::array<GLuint, effect_count> effects = {};
+
+	// Uniform locations of an effect, looked up once when the effect is loaded
+	// A location is -1 when the effect doesn't use that uniform, which GL quietly ignores
+	struct EffectInterface {
+		GLint transform = -1;
+		GLint projection = -1;
+		GLint fcolor = -1;
+		GLint fcolor_fill = -1;
+		GLint opacity = -1;
+		GLint frame = -1;
+		GLint state = -1;
+		GLint time = -1;
+		GLint use_lighting = -1;
+		GLint offset = -1;
+		GLint size = -1;
+		GLint health = -1;
+		GLint xy_ratio = -1;
+		GLint scale = -1;
+		GLint thickness = -1;
+		GLint fborder = -1;
+		GLint room_layout = -1;
+		GLint appearing = -1;
+		GLint start_tile = -1;
+		GLint max_show_distance = -1;
+		GLint spelltype = -1;
+		GLint actual_aoe = -1;
+		GLint side_offset = -1;
+		GLint height_offset = -1;
+		GLint direction = -1;
+		GLint darken_screen_factor = -1;
+		GLint tile_origin = -1;
+		GLint tile_columns = -1;
+		GLint map_top_left = -1;
+		GLint tile_size = -1;
+	};
+	std::array<EffectInterface, effect_count> effect_interfaces = {};
 	// Make sure these paths remain in sync with the associated enumerators.
 	// see damage_type_names for comment explanation
 	const std::array<std::string, effect_count> effect_paths = {
@@ -96,6 +138,13 @@ class RenderSystem {
 		shader_path("light_triangles"), //
 		shader_path("lighting"),		//
 		shader_path("combat_cond"),		//
+		shader_path("enemy_instanced"),	//
+		shader_path("player_instanced"), //
+		shader_path("spritesheet_instanced"), //
+		shader_path("level_tilemap"),	//
+		shader_path("health_bar_instanced"), //
+		shader_path("fancy_bar_instanced"), //
+		shader_path("combat_cond_instanced"), //
 	};
 
 	// TODO: move these constants into animation system most likely, need to finalize
@@ -114,7 +163,12 @@ class RenderSystem {
 	static constexpr float entry_animation_width = 64.f;
 public:
 	// Initialize the window
-	bool init(int width, int height, GLFWwindow* window, std::shared_ptr<MapGeneratorSystem> map);
+	// With a recorder, no window or context is needed and every GL call is recorded instead of issued
+	bool init(int width,
+			  int height,
+			  GLFWwindow* window,
+			  std::shared_ptr<MapGeneratorSystem> map,
+			  RecordingGLBackend* recorder = nullptr);
 
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
@@ -127,11 +181,15 @@ public:
 
 	// Draw all entities
 	void draw();
+	// How far the next frame is between the last simulation tick and the one after it, from 0 to 1
+	void set_interpolation(float alpha) { interpolation = alpha; }
 
 	// Draw UI entities over top
 	void draw_ui(const mat3& projection);
 	void toggle_lighting();
 	void set_lighting(bool enabled);
+	// Draws the lighting and line of sight buffers at 1/downscale of the screen's resolution on each axis
+	void set_lighting_downscale(uint downscale);
 
 	mat3 create_projection_matrix();
 	vec2 mouse_pos_to_screen_pos(dvec2 mouse_pos) const;
@@ -141,6 +199,25 @@ public:
 	void scale_on_scroll(float offset);
 	void on_resize(int width, int height);
 
+	// Renderer counters for the last drawn frame, reset at the start of every draw()
+	struct FrameStats {
+		uint commands = 0;
+		uint draws = 0;
+		uint program_binds = 0;
+		uint vertex_array_binds = 0;
+		uint texture_binds = 0;
+		uint uniform_uploads = 0;
+		// Binds skipped because the state was already current
+		uint redundant_binds = 0;
+		// World entities and rooms that passed and failed the camera cull
+		uint in_view = 0;
+		uint culled = 0;
+	};
+	const FrameStats& get_frame_stats() const { return frame_stats; }
+
+	// Resident bytes and hit, miss and eviction counts for the cached textures of bordered text
+	const LruCacheStats& get_text_cache_stats() const { return text_buffers.get_stats(); }
+
 	float get_screen_scale() const { return screen_scale; }
 	vec2 get_screen_size() const { return screen_size; }
 	vec2 screen_size_capped() const
@@ -156,6 +233,9 @@ private:
 	void initialize_gl_effects();
 	void initialize_gl_meshes();
 	void initialize_gl_geometry_buffers();
+	// Creates one vertex array per geometry, plus instanced ones for batched sprites, so attribute setup only
+	// happens here rather than on every draw
+	void initialize_gl_vertex_arrays();
 	// Initialize the screen texture used as intermediate render target
 	// The draw loop first renders to this texture, then it is used for the water
 	// shader
@@ -172,9 +252,26 @@ private:
 	Transform get_transform(Entity entity, uvec2* tile = nullptr) const;
 	// Helper to get position transform without rotation
 	Transform get_transform_no_rotation(Entity entity) const;
+	// Blends moving entities between their last two simulated positions
+	vec2 interpolate_position(Entity entity, vec2 position) const;
 
 	// Helper to ready the current buffer for re-use
 	void prepare_buffer(vec3 color) const;
+	void prepare_buffer(vec3 color, ivec2 viewport_size) const;
+	// Helpers to make an effect and geometry current for the following draws, these skip binds that are
+	// already current so must be the only way programs, vertex arrays and textures get bound while drawing
+	const EffectInterface& use_effect(EFFECT_ASSET_ID effect);
+	void bind_geometry(GEOMETRY_BUFFER_ID geometry);
+	void bind_instanced_geometry(GEOMETRY_BUFFER_ID geometry);
+	void bind_vertex_array(GLuint vertex_array);
+	void bind_texture(GLuint unit, GLuint texture);
+	// Forgets what is bound, for the start of a frame since anything outside draw() may have changed it
+	void reset_bind_cache();
+	template <typename Upload, typename... Args> void upload_uniform(Upload upload, Args... args)
+	{
+		frame_stats.uniform_uploads++;
+		upload(args...);
+	}
 	// Helper to ready to draw the Textured effect
 	void prepare_for_textured(GLuint texture_id);
 	// Helper to ready to draw the SpriteSheet effect
@@ -184,23 +281,51 @@ private:
 	// Returns vbo, ibo
 	struct TextData;
 	TextData generate_text(const Text& text, bool cursive);
+	// Opens the font in the given size the first time it is asked for
+	TTF_Font* get_font(bool cursive, unsigned int font_size);
+	GlyphAtlas& get_glyph_atlas(bool cursive, unsigned int font_size);
 
 	////////////////////////////////////////////////////////
 	// Internal drawing functions for each entity type
 	void draw_textured_mesh(Entity entity, const RenderRequest& render_request, const mat3& projection);
+	// Queues the sprite to be drawn with others sharing its effect and texture, returns false if it can't be batched
+	bool batch_sprite(Entity entity, const RenderRequest& render_request);
+	// Queue the health bar and condition icons drawn over a world entity
+	void batch_health_bar(Entity entity, const Stats& stats);
+	void batch_conditions(Entity entity, const ActiveConditions& conditions);
+	struct SpriteInstance;
+	using InstanceBatches = std::map<std::pair<EFFECT_ASSET_ID, TEXTURE_ASSET_ID>, std::vector<SpriteInstance>>;
+	// One instanced draw per effect and texture, the batches are emptied but keep their storage
+	void draw_instance_batches(InstanceBatches& batches, const mat3& projection);
 	void draw_effect(Entity entity, const EffectRenderRequest& render_request, const mat3& projection);
-	void draw_condition(Entity entity, int condition_index, float condition_offset, const mat3& projection);
 	void draw_ui_element(Entity entity, const UIRenderRequest& ui_render_request, const mat3& projection);
 	void draw_stat_bar(
 		Transform transform, const Stats& stats, const mat3& projection, bool fancy, float ratio, Entity entity);
+	float get_stat_bar_fill(const Stats& stats, bool fancy, Entity entity) const;
 	void draw_rectangle(EFFECT_ASSET_ID asset, Entity entity, Transform transform, vec2 scale, const mat3& projection);
 	void draw_text(Entity entity, const Text& text, const mat3& projection);
 	void draw_line(Entity entity, const Line& line, const mat3& projection);
+#ifdef ENABLE_PROFILER
+	void draw_profiler_overlay(const mat3& projection);
+#endif
 	void draw_map(const mat3& projection, ColorState color);
+	void draw_map_by_room(const mat3& projection, TEXTURE_ASSET_ID tile_set);
+
+	// Camera culling on a coarse grid of rooms, rebuilt every frame before anything is queued
+	void update_visible_rooms();
+	// False only for entities placed on the map in a room the camera can't see
+	bool in_view(Entity entity);
+	bool room_in_view(uint8_t room_index);
+
+	// Whole level tilemap
+	void init_level_tile_map();
+	void update_level_tile_map();
+	void draw_level_tile_map(const mat3& projection, TEXTURE_ASSET_ID tile_set);
 
 	// Lighting
-	void prepare_for_lit_entity(GLuint program) const;
+	void prepare_for_lit_entity(const EffectInterface& effect);
 	void create_lighting_texture(const mat3& projection);
+	void update_light_masks();
 	void draw_light(Entity entity, const Light& light, const mat3& projection);
 	void draw_lighting(const mat3& projection);
 
@@ -214,24 +339,121 @@ private:
 	// Static buffers
 	std::array<GLuint, geometry_count> vertex_buffers = {};
 	std::array<GLuint, geometry_count> index_buffers = {};
+	std::array<GLsizei, geometry_count> index_counts = {};
+	std::array<GLuint, geometry_count> vertex_arrays = {};
+	// Only the sprite geometries have an instanced vertex array, the rest stay 0
+	std::array<GLuint, geometry_count> instanced_vertex_arrays = {};
+
+	EFFECT_ASSET_ID current_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
+	GEOMETRY_BUFFER_ID current_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 	std::array<Mesh, geometry_count> meshes = {};
 
+	GLuint current_vertex_array = 0;
+	GLuint active_texture_unit = 0;
+	// Textures bound to the units the effects sample from
+	std::array<GLuint, 3> bound_textures = {};
+
+	// The world's entities are emitted as render commands, sorted once, then submitted in order so that
+	// entities sharing a program, texture and geometry draw back to back
+	enum class RenderLayer : uint8_t {
+		Meshes = 0,
+		SpriteBatches = Meshes + 1,
+		// Health bars and condition icons
+		Overlays = SpriteBatches + 1,
+		Effects = Overlays + 1,
+	};
+	struct RenderCommand {
+		// From most to least significant: layer, program, texture, geometry, depth
+		uint64_t key = 0;
+		RenderLayer layer = RenderLayer::Meshes;
+		Entity entity = entt::null;
+	};
+	std::vector<RenderCommand> render_queue;
+	void queue_render_command(RenderLayer layer,
+							  EFFECT_ASSET_ID effect,
+							  TEXTURE_ASSET_ID texture,
+							  GEOMETRY_BUFFER_ID geometry,
+							  Entity entity);
+	void submit_render_queue(const mat3& projection);
+
+	FrameStats frame_stats;
+
+	// Per instance data for batched sprites and overlays, matches the instanced shaders' per instance attributes
+	struct SpriteInstance {
+		mat3 transform;
+		vec4 color;
+		// Frame and state for animated sprites and conditions, offset and size for spritesheets,
+		// fill and width to height ratio for stat bars
+		vec4 frame;
+	};
+	// Sprites and overlays queued this frame, by effect and texture, kept around so their storage is reused between
+	// frames
+	InstanceBatches sprite_batches;
+	InstanceBatches overlay_batches;
+	GLuint sprite_instance_buffer = 0;
+
+	// The level's tile ids live in an R8UI texture that is only re-uploaded when the level or its tiles change,
+	// while each room's reveal state is small enough to upload every frame
+	static constexpr uint level_tiles = MapUtility::map_size * MapUtility::room_size;
+	bool use_level_tile_map = true;
+	GLuint level_tile_texture = 0;
+	GLuint room_state_texture = 0;
+	// The level tilemap has no vertex data, but a vertex array still has to be bound to draw
+	GLuint level_tile_map_vertex_array = 0;
+	int level_tile_map_level = -1;
+	unsigned int level_tile_map_version = 0;
+	unsigned int level_tile_map_generation = 0;
+	std::array<vec4, MapUtility::map_size * MapUtility::map_size> room_states = {};
+
+	// Rooms overlapping the camera's view, grown by a margin so sprites larger than a tile aren't cut off at the edge
+	static constexpr float cull_margin_tiles = 3;
+	std::array<bool, MapUtility::map_size * MapUtility::map_size> visible_rooms = {};
+
 	// Dynamic text buffers
 	struct TextData {
 		GLuint texture;
 		int texture_width;
 		int texture_height;
 	};
-	std::unordered_map<Text, TextData> text_buffers = {};
+	// Every unique string gets its own texture, so only the most recently drawn ones are kept around
+	static constexpr size_t text_cache_budget_bytes = 16 * 1024 * 1024;
+	LruCache<Text, TextData> text_buffers = LruCache<Text, TextData>(
+		text_cache_budget_bytes, [](const Text& /*text*/, TextData& data) { glDeleteTextures(1, &data.texture); });
 	std::unordered_map<unsigned int, TTF_Font*> fonts = {};
 	std::unordered_map<unsigned int, TTF_Font*> cursive_fonts = {};
+	// Text without a border is drawn from its font's glyph atlas, keyed by whether it is cursive and its size
+	std::map<std::pair<bool, unsigned int>, GlyphAtlas> glyph_atlases = {};
+	std::vector<TexturedVertex> text_vertices;
+	std::vector<uint16_t> text_indices;
 
 	std::shared_ptr<MapGeneratorSystem> map_generator;
 
 	// Lighting System
 	LightingSystem& lighting;
+	// Masked lights' tiles share a buffer per kind, static lights' and the others', each only remade when the lighting
+	// system changes a mask of its kind, so a moving light doesn't re-upload every torch
+	struct LightMaskRange {
+		GLint first;
+		GLsizei count;
+	};
+	struct LightMaskBuffer {
+		GEOMETRY_BUFFER_ID geometry;
+		bool static_lights;
+		unsigned int version = std::numeric_limits<unsigned int>::max();
+		// The range of vertices each light draws
+		std::unordered_map<Entity, LightMaskRange> ranges = {};
+	};
+	std::array<LightMaskBuffer, 2> light_mask_buffers = { {
+		{ GEOMETRY_BUFFER_ID::STATIC_LIGHT_MASK, true },
+		{ GEOMETRY_BUFFER_ID::DYNAMIC_LIGHT_MASK, false },
+	} };
 	bool applying_lighting = true;
 	bool use_lighting = true;
+	// Light and shadow edges are tile sized, so they hold up well at a fraction of the screen's resolution
+	uint lighting_downscale = 2;
+	float interpolation = 1.f;
+	ivec2 get_lighting_buffer_size() const;
+	void resize_lighting_buffers();
 
 	// Window handle
 	GLFWwindow* window = nullptr;
@@ -252,8 +474,25 @@ private:
 	vec2 screen_size = { window_width_px, window_height_px };
 
 	Entity screen_state_entity = registry.create();
+#ifdef ENABLE_PROFILER
+	// Text for the profiler overlay, made again whenever restarting the game clears it away
+	Entity profiler_overlay = entt::null;
+#endif
 
 	Debug& debugging;
 };
 
+// Attribute locations shared by every effect, bound before linking so that a geometry's vertex array works with any
+// effect that draws it
+namespace AttributeLocation {
+constexpr GLuint position = 0;
+constexpr GLuint texcoord = 1;
+constexpr GLuint color = 2;
+constexpr GLuint vertex_id = 3;
+// Per instance, the transform takes up one location per column
+constexpr GLuint instance_transform = 4;
+constexpr GLuint instance_frame = 7;
+constexpr GLuint instance_color = 8;
+} // namespace AttributeLocation
+
 bool load_effect_from_file(const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
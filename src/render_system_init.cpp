@@ -11,17 +11,26 @@
 #include <sstream>
 
 // World initialization
-bool RenderSystem::init(int width, int /*height*/, GLFWwindow* window_arg, std::shared_ptr<MapGeneratorSystem> map)
+bool RenderSystem::init(int width,
+						int /*height*/,
+						GLFWwindow* window_arg,
+						std::shared_ptr<MapGeneratorSystem> map,
+						RecordingGLBackend* recorder)
 {
 	map_generator = std::move(map);
 	this->window = window_arg;
 
-	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1); // vsync
+	if (recorder != nullptr) {
+		// Headless, the recorder stands in for the driver's function pointers
+		recorder->install();
+	} else {
+		glfwMakeContextCurrent(window);
+		glfwSwapInterval(1); // vsync
 
-	// Load OpenGL function pointers
-	const int is_fine = gl3w_init();
-	assert(is_fine == 0);
+		// Load OpenGL function pointers
+		const int is_fine = gl3w_init();
+		assert(is_fine == 0);
+	}
 
 	// Create a frame buffer
 	frame_buffer = 0;
@@ -38,8 +47,8 @@ bool RenderSystem::init(int width, int /*height*/, GLFWwindow* window_arg, std::
 	// code to use OpenGL 4.3 (not suported on mac) and add additional .h and .cpp
 	// glDebugMessageCallback((GLDEBUGPROC)errorCallback, nullptr);
 
-	// We are not really using VAO's but without at least one bound we will crash in
-	// some systems.
+	// Every geometry gets its own vertex array in initialize_gl_vertex_arrays, this one is only bound while the
+	// buffers are being set up, without at least one bound we will crash in some systems.
 	GLuint vao = 0;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
@@ -50,6 +59,8 @@ bool RenderSystem::init(int width, int /*height*/, GLFWwindow* window_arg, std::
 	initialize_gl_textures();
 	initialize_gl_effects();
 	initialize_gl_geometry_buffers();
+	initialize_gl_vertex_arrays();
+	init_level_tile_map();
 
 	lighting.init(map_generator);
 
@@ -99,7 +110,52 @@ void RenderSystem::initialize_gl_effects()
 
 		bool is_valid = load_effect_from_file(vertex_shader_name, fragment_shader_name, effects.at(i));
 		assert(is_valid && (GLuint)effects.at(i) != 0);
+
+		const GLuint program = effects.at(i);
+		EffectInterface& effect = effect_interfaces.at(i);
+		effect.transform = glGetUniformLocation(program, "transform");
+		effect.projection = glGetUniformLocation(program, "projection");
+		effect.fcolor = glGetUniformLocation(program, "fcolor");
+		effect.fcolor_fill = glGetUniformLocation(program, "fcolor_fill");
+		effect.opacity = glGetUniformLocation(program, "opacity");
+		effect.frame = glGetUniformLocation(program, "frame");
+		effect.state = glGetUniformLocation(program, "state");
+		effect.time = glGetUniformLocation(program, "time");
+		effect.use_lighting = glGetUniformLocation(program, "use_lighting");
+		effect.offset = glGetUniformLocation(program, "offset");
+		effect.size = glGetUniformLocation(program, "size");
+		effect.health = glGetUniformLocation(program, "health");
+		effect.xy_ratio = glGetUniformLocation(program, "xy_ratio");
+		effect.scale = glGetUniformLocation(program, "scale");
+		effect.thickness = glGetUniformLocation(program, "thickness");
+		effect.fborder = glGetUniformLocation(program, "fborder");
+		effect.room_layout = glGetUniformLocation(program, "room_layout");
+		effect.appearing = glGetUniformLocation(program, "appearing");
+		effect.start_tile = glGetUniformLocation(program, "start_tile");
+		effect.max_show_distance = glGetUniformLocation(program, "max_show_distance");
+		effect.spelltype = glGetUniformLocation(program, "spelltype");
+		effect.actual_aoe = glGetUniformLocation(program, "actual_aoe");
+		effect.side_offset = glGetUniformLocation(program, "side_offset");
+		effect.height_offset = glGetUniformLocation(program, "height_offset");
+		effect.direction = glGetUniformLocation(program, "direction");
+		effect.darken_screen_factor = glGetUniformLocation(program, "darken_screen_factor");
+		effect.tile_origin = glGetUniformLocation(program, "tile_origin");
+		effect.tile_columns = glGetUniformLocation(program, "tile_columns");
+		effect.map_top_left = glGetUniformLocation(program, "map_top_left");
+		effect.tile_size = glGetUniformLocation(program, "tile_size");
+
+		// Texture units never change, so samplers only need to be set once
+		glUseProgram(program);
+		glUniform1i(glGetUniformLocation(program, "sampler0"), 0);
+		glUniform1i(glGetUniformLocation(program, "screen"), 0);
+		glUniform1i(glGetUniformLocation(program, "screen_texture"), 0);
+		glUniform1i(glGetUniformLocation(program, "lighting"), 1);
+		glUniform1i(glGetUniformLocation(program, "los"), 2);
+		glUniform1i(glGetUniformLocation(program, "tile_ids"), 1);
+		glUniform1i(glGetUniformLocation(program, "room_states"), 2);
+		gl_has_errors();
 	}
+	glUseProgram(0);
 }
 
 // One could merge the following two functions as a template function...
@@ -113,6 +169,8 @@ template <class T> void RenderSystem::bind_vbo_and_ibo(uint gid, std::vector<T>
 	glBufferData(
 		GL_ELEMENT_ARRAY_BUFFER, static_cast<int>(sizeof(indices[0]) * indices.size()), indices.data(), GL_STATIC_DRAW);
 	gl_has_errors();
+
+	index_counts.at((uint)gid) = static_cast<GLsizei>(indices.size());
 }
 
 void RenderSystem::initialize_gl_meshes()
@@ -133,6 +191,8 @@ void RenderSystem::initialize_gl_geometry_buffers()
 	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	// Per instance data for batched sprites, refilled every frame
+	glGenBuffers(1, &sprite_instance_buffer);
 
 	// Index and Vertex buffer data initialization.
 	initialize_gl_meshes();
@@ -326,6 +386,140 @@ void RenderSystem::initialize_gl_geometry_buffers()
 	bind_vbo_and_ibo((uint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE, screen_vertices, screen_indices);
 }
 
+void RenderSystem::initialize_gl_vertex_arrays()
+{
+	auto textured_attributes = []() {
+		glEnableVertexAttribArray(AttributeLocation::position);
+		glVertexAttribPointer(AttributeLocation::position, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), nullptr);
+		glEnableVertexAttribArray(AttributeLocation::texcoord);
+		glVertexAttribPointer(
+			AttributeLocation::texcoord,
+			2,
+			GL_FLOAT,
+			GL_FALSE,
+			sizeof(TexturedVertex),
+			(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
+	};
+	auto colored_attributes = []() {
+		glEnableVertexAttribArray(AttributeLocation::position);
+		glVertexAttribPointer(AttributeLocation::position, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), nullptr);
+		glEnableVertexAttribArray(AttributeLocation::color);
+		glVertexAttribPointer(
+			AttributeLocation::color,
+			3,
+			GL_FLOAT,
+			GL_FALSE,
+			sizeof(ColoredVertex),
+			(void*)sizeof(vec3)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
+	};
+
+	glGenVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	for (uint i = 0; i < geometry_count; i++) {
+		glBindVertexArray(vertex_arrays.at(i));
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers.at(i));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers.at(i));
+
+		switch ((GEOMETRY_BUFFER_ID)i) {
+		case GEOMETRY_BUFFER_ID::SPRITE:
+		case GEOMETRY_BUFFER_ID::SMALL_SPRITE:
+		case GEOMETRY_BUFFER_ID::ENTRY_ANIMATION_STRIP:
+		case GEOMETRY_BUFFER_ID::DEATH:
+		case GEOMETRY_BUFFER_ID::TEXT_GLYPHS:
+			textured_attributes();
+			break;
+		case GEOMETRY_BUFFER_ID::ROOM:
+			glEnableVertexAttribArray(AttributeLocation::vertex_id);
+			glVertexAttribIPointer(AttributeLocation::vertex_id, 1, GL_INT, sizeof(int), nullptr);
+			break;
+		case GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE:
+			glEnableVertexAttribArray(AttributeLocation::position);
+			glVertexAttribPointer(AttributeLocation::position, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), nullptr);
+			break;
+		case GEOMETRY_BUFFER_ID::LIGHTING_TRIANGLES:
+			glEnableVertexAttribArray(AttributeLocation::position);
+			glVertexAttribPointer(AttributeLocation::position, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+			break;
+		default:
+			colored_attributes();
+			break;
+		}
+		gl_has_errors();
+	}
+
+	// Batched sprites read their transform, colour and frame per instance
+	for (GEOMETRY_BUFFER_ID geometry :
+		 { GEOMETRY_BUFFER_ID::SPRITE, GEOMETRY_BUFFER_ID::SMALL_SPRITE, GEOMETRY_BUFFER_ID::HEALTH }) {
+		GLuint& vao = instanced_vertex_arrays.at((uint)geometry);
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers.at((uint)geometry));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers.at((uint)geometry));
+		if (geometry == GEOMETRY_BUFFER_ID::HEALTH) {
+			colored_attributes();
+		} else {
+			textured_attributes();
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, sprite_instance_buffer);
+		for (GLuint column = 0; column < 3; column++) {
+			GLuint loc = AttributeLocation::instance_transform + column;
+			glEnableVertexAttribArray(loc);
+			glVertexAttribPointer(
+				loc,
+				3,
+				GL_FLOAT,
+				GL_FALSE,
+				sizeof(SpriteInstance),
+				(void*)(offsetof(SpriteInstance, transform) + sizeof(vec3) * column)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
+			glVertexAttribDivisor(loc, 1);
+		}
+		glEnableVertexAttribArray(AttributeLocation::instance_color);
+		glVertexAttribPointer(
+			AttributeLocation::instance_color,
+			4,
+			GL_FLOAT,
+			GL_FALSE,
+			sizeof(SpriteInstance),
+			(void*)offsetof(SpriteInstance, color)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
+		glVertexAttribDivisor(AttributeLocation::instance_color, 1);
+		glEnableVertexAttribArray(AttributeLocation::instance_frame);
+		glVertexAttribPointer(
+			AttributeLocation::instance_frame,
+			4,
+			GL_FLOAT,
+			GL_FALSE,
+			sizeof(SpriteInstance),
+			(void*)offsetof(SpriteInstance, frame)); // NOLINT(performance-no-int-to-ptr,cppcoreguidelines-pro-type-cstyle-cast)
+		glVertexAttribDivisor(AttributeLocation::instance_frame, 1);
+		gl_has_errors();
+	}
+
+	glBindVertexArray(0);
+	current_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+}
+
+void RenderSystem::init_level_tile_map()
+{
+	glGenVertexArrays(1, &level_tile_map_vertex_array);
+
+	// One texel per tile, filled in once a level is loaded
+	glGenTextures(1, &level_tile_texture);
+	glBindTexture(GL_TEXTURE_2D, level_tile_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, level_tiles, level_tiles, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl_has_errors();
+
+	// One texel per room
+	glGenTextures(1, &room_state_texture);
+	glBindTexture(GL_TEXTURE_2D, room_state_texture);
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_RGBA32F, MapUtility::map_size, MapUtility::map_size, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	gl_has_errors();
+}
+
 RenderSystem::~RenderSystem()
 {
 	try {
@@ -333,7 +527,17 @@ RenderSystem::~RenderSystem()
 		// but it's polite to clean after yourself.
 		glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 		glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+		glDeleteBuffers(1, &sprite_instance_buffer);
+		glDeleteVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+		for (GLuint vao : instanced_vertex_arrays) {
+			if (vao != 0) {
+				glDeleteVertexArrays(1, &vao);
+			}
+		}
+		glDeleteVertexArrays(1, &level_tile_map_vertex_array);
 		glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+		glDeleteTextures(1, &level_tile_texture);
+		glDeleteTextures(1, &room_state_texture);
 		glDeleteTextures(1, &off_screen_render_buffer_color);
 		glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
 		glDeleteTextures(1, &lighting_buffer_color);
@@ -352,12 +556,16 @@ RenderSystem::~RenderSystem()
 		gl_has_errors();
 
 		// Delete text-related resources
-		for (auto& text_data : text_buffers) {
-			glDeleteTextures(1, &text_data.second.texture);
+		text_buffers.clear();
+		for (auto& atlas : glyph_atlases) {
+			atlas.second.destroy();
 		}
 		for (auto& font : fonts) {
 			TTF_CloseFont(font.second);
 		}
+		for (auto& font : cursive_fonts) {
+			TTF_CloseFont(font.second);
+		}
 
 		// remove all entities created by the render system
 		auto view = registry.view<RenderRequest>();
@@ -398,9 +606,10 @@ bool RenderSystem::init_lighting()
 	glGenFramebuffers(1, &lighting_frame_buffer);
 	glBindFramebuffer(GL_FRAMEBUFFER, lighting_frame_buffer);
 
+	// Sized by resize_lighting_buffers, linear filtering upsamples them when they are smaller than the screen
 	glGenTextures(1, &lighting_buffer_color);
 	glBindTexture(GL_TEXTURE_2D, lighting_buffer_color);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, window_width_px, window_height_px, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	gl_has_errors();
@@ -408,7 +617,7 @@ bool RenderSystem::init_lighting()
 	glGenRenderbuffers(1, &lighting_buffer_depth);
 	glBindRenderbuffer(GL_RENDERBUFFER, lighting_buffer_depth);
 	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, lighting_buffer_color, 0);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, window_width_px, window_height_px);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 1, 1);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, lighting_buffer_depth);
 	gl_has_errors();
 
@@ -419,7 +628,7 @@ bool RenderSystem::init_lighting()
 
 	glGenTextures(1, &los_buffer_color);
 	glBindTexture(GL_TEXTURE_2D, los_buffer_color);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, window_width_px, window_height_px, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	gl_has_errors();
@@ -427,7 +636,7 @@ bool RenderSystem::init_lighting()
 	glGenRenderbuffers(1, &los_buffer_depth);
 	glBindRenderbuffer(GL_RENDERBUFFER, los_buffer_depth);
 	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, los_buffer_color, 0);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, window_width_px, window_height_px);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 1, 1);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, los_buffer_depth);
 	gl_has_errors();
 
@@ -435,9 +644,26 @@ bool RenderSystem::init_lighting()
 
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
 
+	resize_lighting_buffers();
 	return true;
 }
 
+void RenderSystem::resize_lighting_buffers()
+{
+	ivec2 size = get_lighting_buffer_size();
+	for (GLuint texture : { lighting_buffer_color, los_buffer_color }) {
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		gl_has_errors();
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	for (GLuint depth : { lighting_buffer_depth, los_buffer_depth }) {
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, size.x, size.y);
+		gl_has_errors();
+	}
+}
+
 bool gl_compile_shader(GLuint shader)
 {
 	glCompileShader(shader);
@@ -504,6 +730,13 @@ bool load_effect_from_file(const std::string& vs_path, const std::string& fs_pat
 	out_program = glCreateProgram();
 	glAttachShader(out_program, vertex);
 	glAttachShader(out_program, fragment);
+	glBindAttribLocation(out_program, AttributeLocation::position, "in_position");
+	glBindAttribLocation(out_program, AttributeLocation::texcoord, "in_texcoord");
+	glBindAttribLocation(out_program, AttributeLocation::color, "in_color");
+	glBindAttribLocation(out_program, AttributeLocation::vertex_id, "cur_vertex_id");
+	glBindAttribLocation(out_program, AttributeLocation::instance_transform, "in_transform");
+	glBindAttribLocation(out_program, AttributeLocation::instance_frame, "in_frame");
+	glBindAttribLocation(out_program, AttributeLocation::instance_color, "in_instance_color");
 	glLinkProgram(out_program);
 	gl_has_errors();
 
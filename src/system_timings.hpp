@@ -0,0 +1,70 @@
+#pragma once
+
+// stlib
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// internal
+#include "profiler.hpp"
+
+// Time spent in each system's step, summed over a run
+class SystemTimings {
+public:
+	enum class System : uint8_t {
+		World = 0,
+		AI = World + 1,
+		Physics = AI + 1,
+		Collisions = Physics + 1,
+		Animations = Collisions + 1,
+		Map = Animations + 1,
+		Turns = Map + 1,
+		Music = Turns + 1,
+		Lighting = Music + 1,
+		Render = Lighting + 1,
+		Count = Render + 1,
+	};
+
+	// Runs step and adds how long it took to the system's total, and to the profiler when it's built in
+	template <typename Step> void time(System system, Step&& step)
+	{
+		PROFILE_SCOPE(names.at(static_cast<size_t>(system)));
+		auto start = Clock::now();
+		step();
+		totals_ns.at(static_cast<size_t>(system))
+			+= std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	}
+
+	double get_total_ms(System system) const
+	{
+		return static_cast<double>(totals_ns.at(static_cast<size_t>(system))) / 1e6;
+	}
+
+	void clear() { totals_ns.fill(0); }
+
+	// One line per system with its total and its average per tick
+	void print(uint64_t ticks) const
+	{
+		double total_ms = 0;
+		for (size_t i = 0; i < totals_ns.size(); i++) {
+			double ms = get_total_ms(static_cast<System>(i));
+			total_ms += ms;
+			printf("  %-12s %10.2f ms %10.2f us/tick\n",
+				   names.at(i),
+				   ms,
+				   ms * 1000 / static_cast<double>(std::max<uint64_t>(ticks, 1)));
+		}
+		printf("  %-12s %10.2f ms\n", "total", total_ms);
+	}
+
+private:
+	using Clock = std::chrono::high_resolution_clock;
+
+	static constexpr std::array<const char*, static_cast<size_t>(System::Count)> names = {
+		"world", "ai", "physics", "collisions", "animations", "map", "turns", "music", "lighting", "render",
+	};
+
+	std::array<int64_t, static_cast<size_t>(System::Count)> totals_ns = {};
+};
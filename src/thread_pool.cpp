@@ -0,0 +1,108 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t num_workers)
+{
+	if (num_workers == hardware_workers) {
+		size_t cores = std::thread::hardware_concurrency();
+		num_workers = (cores > 1) ? cores - 1 : 0;
+	}
+	workers.reserve(num_workers);
+	for (size_t i = 0; i < num_workers; i++) {
+		workers.emplace_back([this]() { worker_loop(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task)
+{
+	if (count == 0) {
+		return;
+	}
+	// Not worth waking anyone up for
+	if (workers.empty() || count == 1) {
+		for (size_t i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_task = &task;
+#ifdef ENABLE_PROFILER
+		current_profiler = &Profiler::current();
+#endif
+		batch_size = count;
+		next_index = 0;
+		completed = 0;
+		generation++;
+	}
+	work_ready.notify_all();
+
+	run_batch();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	work_done.wait(lock, [this]() { return completed == batch_size; });
+	current_task = nullptr;
+}
+
+void ThreadPool::worker_loop()
+{
+	size_t seen_generation = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_ready.wait(lock, [&]() { return stopping || generation != seen_generation; });
+			if (stopping) {
+				return;
+			}
+			seen_generation = generation;
+		}
+		run_batch();
+	}
+}
+
+void ThreadPool::run_batch()
+{
+	while (true) {
+		size_t index = 0;
+		const std::function<void(size_t)>* task = nullptr;
+#ifdef ENABLE_PROFILER
+		Profiler* profiler = nullptr;
+#endif
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (current_task == nullptr || next_index >= batch_size) {
+				return;
+			}
+			index = next_index++;
+			task = current_task;
+#ifdef ENABLE_PROFILER
+			profiler = current_profiler;
+#endif
+		}
+
+#ifdef ENABLE_PROFILER
+		Profiler::Redirect redirect(profiler);
+#endif
+		(*task)(index);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (++completed == batch_size) {
+			work_done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+// Small fixed-size pool of worker threads used to split independent per-frame work (e.g. one light's field of view)
+// across cores. Work is submitted as a batch and the caller blocks until the whole batch has completed, so there is no
+// need for futures or per-task allocations.
+class ThreadPool {
+public:
+	// Uses one thread per hardware core, minus the calling thread
+	static constexpr size_t hardware_workers = std::numeric_limits<size_t>::max();
+
+	// With no workers, everything runs on the calling thread
+	explicit ThreadPool(size_t num_workers = hardware_workers);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+	// Calls task(i) for every i in [0, count), spread over the workers and the calling thread
+	// Returns once every call has finished
+	void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+	size_t size() const { return workers.size() + 1; }
+
+private:
+	void worker_loop();
+	// Claims and runs indices from the current batch until it is exhausted
+	void run_batch();
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+
+	const std::function<void(size_t)>* current_task = nullptr;
+#ifdef ENABLE_PROFILER
+	// Workers time the batch's tasks into the profiler of the thread that submitted it
+	Profiler* current_profiler = nullptr;
+#endif
+	size_t batch_size = 0;
+	size_t next_index = 0;
+	size_t completed = 0;
+	// Incremented per batch so sleeping workers can tell a new batch from a spurious wakeup
+	size_t generation = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.hpp"
+
+// stlib
+#include <vector>
+
+// Recycles short-lived entities of one kind, marked by the Kind component, e.g. the lit walls remade every tick
+// Releasing an entity only takes its Kind away, so its id and its other components' storage slots are reused by the
+// next entity acquired, rather than creating and destroying entities over and over. That keeps the registry from
+// churning, and the pools of long-lived components like WorldPosition from being shuffled by swap and pop.
+// A released entity keeps its other components, so only pool kinds whose other components nothing views on their own.
+// Like the registry, a pool belongs to one thread.
+template <typename Kind> class TransientPool {
+public:
+	// An entity with a Kind made from args, reusing a released one if there is one, whose other components still hold
+	// their last values and should be set with emplace_or_replace
+	template <typename... Args> Entity acquire(Args&&... args)
+	{
+		while (!released.empty()) {
+			Entity entity = released.back();
+			released.pop_back();
+			// Anything may have destroyed it since, e.g. restarting the game
+			if (registry.valid(entity)) {
+				registry.emplace<Kind>(entity, std::forward<Args>(args)...);
+				return entity;
+			}
+		}
+		Entity entity = registry.create();
+		registry.emplace<Kind>(entity, std::forward<Args>(args)...);
+		return entity;
+	}
+
+	// Releases every entity of the kind at once, for kinds that are made afresh every frame or tick
+	void release_all()
+	{
+		auto view = registry.view<Kind>();
+		released.insert(released.end(), view.begin(), view.end());
+		registry.clear<Kind>();
+	}
+
+	void release(Entity entity)
+	{
+		registry.remove<Kind>(entity);
+		released.push_back(entity);
+	}
+
+private:
+	std::vector<Entity> released;
+};
@@ -48,19 +48,36 @@ void UISystem::on_key(int key, int action, int /*mod*/, dvec2 mouse_screen_pos)
 	// Change attack
 	// Key Codes for 1-9
 	if (49 <= key && key <= 57) {
-		size_t index = ((size_t)key) - 49;
-		for (Slot slot : attacks_slots) {
-			Entity weapon_entity = Inventory::get(registry.view<Player>().front(), slot);
-			if (weapon_entity != entt::null) {
-				Weapon& weapon = registry.get<Weapon>(weapon_entity);
-				if (index < weapon.given_attacks.size()) {
-					set_current_attack(slot, index);
-					break;
-				}
-				index -= weapon.given_attacks.size();
+		select_attack(((size_t)key) - 49);
+	}
+}
+
+bool UISystem::select_attack(size_t index)
+{
+	for (Slot slot : attacks_slots) {
+		Entity weapon_entity = Inventory::get(registry.view<Player>().front(), slot);
+		if (weapon_entity != entt::null) {
+			Weapon& weapon = registry.get<Weapon>(weapon_entity);
+			if (index < weapon.given_attacks.size()) {
+				set_current_attack(slot, index);
+				return true;
 			}
+			index -= weapon.given_attacks.size();
 		}
 	}
+	return false;
+}
+
+size_t UISystem::get_attack_count() const
+{
+	size_t count = 0;
+	for (Slot slot : attacks_slots) {
+		Entity weapon_entity = Inventory::get(registry.view<Player>().front(), slot);
+		if (weapon_entity != entt::null) {
+			count += registry.get<Weapon>(weapon_entity).given_attacks.size();
+		}
+	}
+	return count;
 }
 
 void UISystem::try_settle_held()
@@ -458,6 +475,8 @@ void UISystem::update_resource_count()
 	}
 }
 
+void UISystem::start_game() { switch_to_group(groups.at((size_t)Groups::HUD)); }
+
 void UISystem::end_game(bool victory)
 {
 	switch_to_group(groups.at((size_t)(victory ? Groups::VictoryScreen : Groups::DeathScreen)));
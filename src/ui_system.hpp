@@ -22,6 +22,8 @@ public:
 			  std::function<void()> restart_world);
 
 	void restart_game();
+	// Leaves the main menu for the game, as the start button does
+	void start_game();
 
 	void on_key(int key, int action, int /*mod*/, dvec2 mouse_screen_pos);
 	bool on_left_click(int action, dvec2 mouse_screen_pos);
@@ -30,6 +32,10 @@ public:
 	bool player_can_act();
 	bool game_in_progress();
 
+	// Makes the attack numbered as the 1-9 keys number them current, returns false if there is no such attack
+	bool select_attack(size_t index);
+	// Number of attacks the player's equipment gives, which select_attack can choose from
+	size_t get_attack_count() const;
 	bool has_current_attack() const;
 	Attack& get_current_attack();
 
@@ -0,0 +1,91 @@
+#include "vector_environment.hpp"
+
+// stlib
+#include <cassert>
+
+VectorEnvironment::VectorEnvironment(size_t count)
+	: count(count)
+{
+	workers.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		workers.emplace_back([this, i]() { worker_loop(i); });
+	}
+}
+
+VectorEnvironment::~VectorEnvironment()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	work_ready.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+std::vector<BotObservation> VectorEnvironment::reset(const std::vector<uint64_t>& seeds)
+{
+	assert(seeds.size() == count);
+	std::vector<BotObservation> observations(count);
+	run([&](size_t i, BotEnvironment& environment) { observations.at(i) = environment.reset(seeds.at(i)); });
+	return observations;
+}
+
+std::vector<BotObservation> VectorEnvironment::reset(const std::vector<uint64_t>& seeds, const std::vector<bool>& mask)
+{
+	assert(seeds.size() == count && mask.size() == count);
+	std::vector<BotObservation> observations(count);
+	run([&](size_t i, BotEnvironment& environment) {
+		bool needs_reset = mask.at(i) || !environment.has_game();
+		observations.at(i) = needs_reset ? environment.reset(seeds.at(i)) : environment.observe();
+	});
+	return observations;
+}
+
+std::vector<BotStepResult> VectorEnvironment::step(const std::vector<PlayerAction>& actions)
+{
+	assert(actions.size() == count);
+	std::vector<BotStepResult> results(count);
+	run([&](size_t i, BotEnvironment& environment) { results.at(i) = environment.step(actions.at(i)); });
+	return results;
+}
+
+void VectorEnvironment::run(const std::function<void(size_t, BotEnvironment&)>& task)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	current_task = &task;
+	finished_workers = 0;
+	generation++;
+	work_ready.notify_all();
+	work_done.wait(lock, [this]() { return finished_workers == workers.size(); });
+	current_task = nullptr;
+}
+
+void VectorEnvironment::worker_loop(size_t index)
+{
+	// Created and destroyed here so its game has this thread's registry to itself, as two games sharing a registry
+	// would restart and look up each other's entities
+	// The workers already keep every core busy, so it doesn't light in parallel
+	BotEnvironment environment(0);
+
+	size_t seen_generation = 0;
+	while (true) {
+		const std::function<void(size_t, BotEnvironment&)>* task = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_ready.wait(lock, [&]() { return stopping || generation != seen_generation; });
+			if (stopping) {
+				return;
+			}
+			seen_generation = generation;
+			task = current_task;
+		}
+		(*task)(index, environment);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished_workers++;
+		}
+		work_done.notify_one();
+	}
+}
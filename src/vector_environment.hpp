@@ -0,0 +1,54 @@
+#pragma once
+
+#include "bot_environment.hpp"
+
+// stlib
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Steps a batch of BotEnvironments in parallel, for training and benchmarking automated players
+// Every environment lives on a worker thread of its own for its whole life, since each game needs its thread's registry
+// to itself, so with more environments than cores the system time slices the workers
+class VectorEnvironment {
+public:
+	explicit VectorEnvironment(size_t count);
+	~VectorEnvironment();
+
+	VectorEnvironment(const VectorEnvironment&) = delete;
+	VectorEnvironment& operator=(const VectorEnvironment&) = delete;
+	VectorEnvironment(VectorEnvironment&&) = delete;
+	VectorEnvironment& operator=(VectorEnvironment&&) = delete;
+
+	size_t size() const { return count; }
+
+	// Resets environment i from seeds[i], there must be one seed per environment
+	std::vector<BotObservation> reset(const std::vector<uint64_t>& seeds);
+	// Resets only the environments where mask is set, such as those that just finished, and observes the rest
+	// Environments that were never reset are reset whatever the mask says, as there is no game to observe yet
+	std::vector<BotObservation> reset(const std::vector<uint64_t>& seeds, const std::vector<bool>& mask);
+	// Applies actions[i] to environment i, there must be one action per environment and every environment must have
+	// been reset
+	// Environments that finish are left finished until they're reset
+	std::vector<BotStepResult> step(const std::vector<PlayerAction>& actions);
+
+private:
+	// Calls task(i, environment i) for every environment on the thread that owns it, returns once all have finished
+	void run(const std::function<void(size_t, BotEnvironment&)>& task);
+	void worker_loop(size_t index);
+
+	const size_t count;
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+
+	const std::function<void(size_t, BotEnvironment&)>* current_task = nullptr;
+	size_t finished_workers = 0;
+	// Incremented per batch so sleeping workers can tell a new batch from a spurious wakeup
+	size_t generation = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,79 @@
+#include "visibility_table.hpp"
+
+#include <algorithm>
+
+void VisibilityTable::VisibleSet::assign(const std::vector<uvec2>& tiles)
+{
+	bits.clear();
+	if (tiles.empty()) {
+		top_left = size = uvec2(0);
+		return;
+	}
+	uvec2 bottom_right = tiles.front();
+	top_left = tiles.front();
+	for (const uvec2& tile : tiles) {
+		top_left = min(top_left, tile);
+		bottom_right = max(bottom_right, tile);
+	}
+	size = bottom_right - top_left + uvec2(1);
+	bits.resize((size.x * size.y + 63) / 64, 0);
+	for (const uvec2& tile : tiles) {
+		uvec2 local = tile - top_left;
+		size_t bit = static_cast<size_t>(local.y) * size.x + local.x;
+		bits.at(bit / 64) |= uint64_t(1) << (bit % 64);
+	}
+}
+
+bool VisibilityTable::VisibleSet::contains(uvec2 tile) const
+{
+	if (tile.x < top_left.x || tile.y < top_left.y || tile.x >= top_left.x + size.x
+		|| tile.y >= top_left.y + size.y) {
+		return false;
+	}
+	uvec2 local = tile - top_left;
+	size_t bit = static_cast<size_t>(local.y) * size.x + local.x;
+	return ((bits.at(bit / 64) >> (bit % 64)) & 1) != 0;
+}
+
+void VisibilityTable::reset(int new_level, unsigned int version, const OpacityGrid& opacity)
+{
+	level = new_level;
+	occlusion_version = version;
+	opaque = opacity;
+	sets.assign(static_cast<size_t>(map_tiles) * map_tiles, VisibleSet());
+}
+
+const VisibilityTable::VisibleSet* VisibilityTable::find(uvec2 from) const
+{
+	if (!built() || from.x >= map_tiles || from.y >= map_tiles) {
+		return nullptr;
+	}
+	const VisibleSet& set = sets.at(index(from));
+	return set.empty() ? nullptr : &set;
+}
+
+std::vector<uvec2> VisibilityTable::tiles_seeing_any(const std::vector<uvec2>& targets) const
+{
+	std::vector<uvec2> result;
+	for (uint y = 0; y < map_tiles; y++) {
+		for (uint x = 0; x < map_tiles; x++) {
+			const VisibleSet& set = sets.at(index(uvec2(x, y)));
+			if (set.empty()) {
+				continue;
+			}
+			if (std::any_of(targets.begin(), targets.end(), [&set](uvec2 target) { return set.contains(target); })) {
+				result.emplace_back(x, y);
+			}
+		}
+	}
+	return result;
+}
+
+size_t VisibilityTable::memory_usage() const
+{
+	size_t total = sizeof(VisibleSet) * sets.size();
+	for (const VisibleSet& set : sets) {
+		total += set.bits.size() * sizeof(uint64_t);
+	}
+	return total;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "common.hpp"
+
+#include <bitset>
+
+// Precomputed potentially visible sets for a level: for every walkable tile, the tiles that can be seen from it.
+// Each set is stored as a bitset over the bounding box of what it contains, which keeps a tile in a small room
+// down to a few words instead of a bit per tile of the whole map.
+class VisibilityTable {
+public:
+	static constexpr uint map_tiles = MapUtility::map_size * MapUtility::room_size;
+	using OpacityGrid = std::bitset<map_tiles * map_tiles>;
+
+	struct VisibleSet {
+		uvec2 top_left = uvec2(0);
+		uvec2 size = uvec2(0);
+		std::vector<uint64_t> bits;
+
+		void assign(const std::vector<uvec2>& tiles);
+		bool contains(uvec2 tile) const;
+		bool empty() const { return bits.empty(); }
+	};
+
+	// Level and occlusion version the table currently reflects
+	int level = -1;
+	unsigned int occlusion_version = 0;
+	// Which tiles were opaque when the sets were computed, used to work out what changed
+	OpacityGrid opaque;
+
+	bool built() const { return level != -1; }
+	void reset(int new_level, unsigned int version, const OpacityGrid& opacity);
+
+	VisibleSet& at(uvec2 from) { return sets.at(index(from)); }
+	const VisibleSet* find(uvec2 from) const;
+	void remove(uvec2 from) { sets.at(index(from)) = VisibleSet(); }
+
+	// Tiles whose visible set includes any of the given tiles
+	std::vector<uvec2> tiles_seeing_any(const std::vector<uvec2>& targets) const;
+
+	size_t memory_usage() const;
+
+	static size_t index(uvec2 tile) { return static_cast<size_t>(tile.y) * map_tiles + tile.x; }
+
+private:
+	std::vector<VisibleSet> sets;
+};
@@ -27,11 +27,12 @@ WorldSystem::WorldSystem(Debug& debugging,
 						 std::shared_ptr<TurnSystem> turns,
 						 std::shared_ptr<TutorialSystem> tutorials,
 						 std::shared_ptr<UISystem> ui,
-						 std::shared_ptr<SoLoud::Soloud> so_loud)
+						 std::shared_ptr<SoLoud::Soloud> so_loud,
+						 std::shared_ptr<RandomStreams> random)
 
 	: debugging(debugging)
 	, so_loud(std::move(so_loud))
-	, rng(std::make_shared<std::default_random_engine>(std::default_random_engine(std::random_device()())))
+	, random(std::move(random))
 	, animations(std::move(animations))
 	, combat(std::move(combat))
 	, loot(std::move(loot))
@@ -42,8 +43,8 @@ WorldSystem::WorldSystem(Debug& debugging,
 	, tutorials(std::move(tutorials))
 	, ui(std::move(ui))
 {
-	this->combat->init(rng, this->animations, this->loot, this->map_generator, this->tutorials);
-	this->loot->init(rng, this->tutorials);
+	this->combat->init(this->random->get(RandomStreams::Stream::Combat), this->animations, this->loot, this->map_generator, this->tutorials);
+	this->loot->init(this->random->get(RandomStreams::Stream::Loot), this->tutorials);
 	this->loot->on_pickup([this](const Entity& item, size_t slot) { this->ui->add_to_inventory(item, slot); });
 	this->combat->on_death([this](const Entity& entity) {
 		this->ui->update_resource_count();
@@ -63,7 +64,9 @@ WorldSystem::~WorldSystem()
 	registry.clear();
 
 	// Close the window
-	glfwDestroyWindow(window);
+	if (window != nullptr) {
+		glfwDestroyWindow(window);
+	}
 }
 
 // Debugging
@@ -107,20 +110,25 @@ GLFWwindow* WorldSystem::create_window(int width, int height)
 	// Input is handled using GLFW, for more info see
 	// http://www.glfw.org/docs/latest/input_guide.html
 	glfwSetWindowUserPointer(window, this);
-	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) {
-		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_key(_0, _1, _2, _3);
+	auto key_redirect = [](GLFWwindow* wnd, int _0, int /*_1*/, int _2, int _3) {
+		InputEvent event = { 0, InputEvent::Type::Key, _0, _2, _3 };
+		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_window_input(event);
 	};
 	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) {
-		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_mouse_move({ _0, _1 });
+		InputEvent event = { 0, InputEvent::Type::Move, 0, 0, 0, vec2(_0, _1) };
+		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_window_input(event);
 	};
 	auto mouse_click_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2) {
-		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_mouse_click(_0, _1, _2);
+		InputEvent event = { 0, InputEvent::Type::Click, _0, _1, _2 };
+		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_window_input(event);
 	};
 	auto scroll_redirect = [](GLFWwindow* wnd, double /*_0*/, double _1) {
-		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_mouse_scroll(static_cast<float>(_1));
+		InputEvent event = { 0, InputEvent::Type::Scroll, 0, 0, 0, vec2(0, _1) };
+		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_window_input(event);
 	};
 	auto resize_redirect = [](GLFWwindow* wnd, int width, int height) {
-		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_resize(width, height);
+		InputEvent event = { 0, InputEvent::Type::Resize, width, height };
+		static_cast<WorldSystem*>(glfwGetWindowUserPointer(wnd))->on_window_input(event);
 	};
 	glfwSetKeyCallback(window, key_redirect);
 	glfwSetCursorPosCallback(window, cursor_pos_redirect);
@@ -129,30 +137,33 @@ GLFWwindow* WorldSystem::create_window(int width, int height)
 	glfwSetWindowSizeLimits(window, GLFW_DONT_CARE, GLFW_DONT_CARE, GLFW_DONT_CARE, GLFW_DONT_CARE);
 	glfwSetFramebufferSizeCallback(window, resize_redirect);
 
-	light_sword_wav.load(audio_path("sword1.wav").c_str());
-	fire_spell_wav.load(audio_path("fireball.wav").c_str());
-	ice_spell_wav.load(audio_path("ice.wav").c_str());
-	earth_spell_wav.load(audio_path("earth.wav").c_str());
-	wind_spell_wav.load(audio_path("wind.wav").c_str());
-
-
 	return window;
 }
 
 void WorldSystem::init(RenderSystem* renderer_arg)
 {
 	this->renderer = renderer_arg;
+
+	// Loaded here rather than with the window, so headless games still have them to play
+	light_sword_wav.load(audio_path("sword1.wav").c_str());
+	fire_spell_wav.load(audio_path("fireball.wav").c_str());
+	ice_spell_wav.load(audio_path("ice.wav").c_str());
+	earth_spell_wav.load(audio_path("earth.wav").c_str());
+	wind_spell_wav.load(audio_path("wind.wav").c_str());
+
 	ui->init(
 		renderer_arg, loot, music, tutorials, story, [this]() { try_change_color(); }, [this]() { restart_game(); });
 	animations->init(renderer_arg);
 
 	// Set all states to default
-	restart_game();
+	restart_game(random->get_seed());
 }
 
 // Update our game world
 bool WorldSystem::step(float elapsed_ms_since_last_update)
 {
+	tick++;
+
 	// Remove debug info from the last step
 	auto debug_view = registry.view<DebugComponent>();
 	registry.destroy(debug_view.begin(), debug_view.end());
@@ -198,9 +209,13 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 	return true;
 }
 
+void WorldSystem::restart_game() { restart_game(random->get_next_seed()); }
+
 // Reset the world state to its initial state
-void WorldSystem::restart_game()
+void WorldSystem::restart_game(uint64_t seed)
 {
+	random->set_seed(seed);
+	printf("Game seed %llu\n", static_cast<unsigned long long>(seed));
 
 	// Debugging for memory/component leaks
 	std::cout << "Alive: " << registry.alive() << std::endl;
@@ -303,21 +318,169 @@ void WorldSystem::handle_collisions()
 		// Stops projectile motion, adds projectile to list of resolved projectiles
 		registry.get<Velocity>(entity).speed = 0;
 		registry.remove<ActiveProjectile>(entity);
-		registry.emplace<ResolvedProjectile>(entity);
+		ResolvedProjectile& resolved = registry.emplace<ResolvedProjectile>(entity);
+		if (turbo) {
+			resolved.counter = 0;
+		}
 	}
 	// Remove all collisions from this simulation step
 	registry.clear<Collision>();
 }
 
 // Should the game be over?
-bool WorldSystem::is_over() const { return bool(glfwWindowShouldClose(window)); }
+// Without a window, whoever drives the game decides when it stops
+bool WorldSystem::is_over() const { return window != nullptr && bool(glfwWindowShouldClose(window)); }
 
-// Returns arrow to player after firing
-void WorldSystem::return_arrow_to_player()
+bool WorldSystem::is_game_finished() const { return registry.get<Stats>(player).health <= 0 || end_of_game; }
+
+dvec2 WorldSystem::get_cursor_position() const
 {
+	if (window == nullptr || !window_input) {
+		return cursor_position;
+	}
 	dvec2 mouse_pos = {};
 	glfwGetCursorPos(window, &mouse_pos.x, &mouse_pos.y);
-	on_mouse_move(mouse_pos);
+	return mouse_pos;
+}
+
+void WorldSystem::on_window_input(const InputEvent& event)
+{
+	if (window_input) {
+		send_input(event);
+	}
+}
+
+void WorldSystem::send_input(InputEvent event)
+{
+	event.tick = tick;
+	if (input_log != nullptr) {
+		input_log->record(event);
+	}
+	switch (event.type) {
+	case InputEvent::Type::Key:
+		on_key(event.code, 0, event.action, event.mods);
+		break;
+	case InputEvent::Type::Click:
+		on_mouse_click(event.code, event.action, event.mods);
+		break;
+	case InputEvent::Type::Move:
+		on_mouse_move(event.position);
+		break;
+	case InputEvent::Type::Scroll:
+		on_mouse_scroll(event.position.y);
+		break;
+	case InputEvent::Type::Resize:
+		on_resize(event.code, event.action);
+		break;
+	default:
+		break;
+	}
+}
+
+void WorldSystem::record_input(InputLog* log)
+{
+	input_log = log;
+	if (input_log == nullptr) {
+		return;
+	}
+	// No callback reports the size and cursor the window starts with, so log them as the first inputs
+	if (window != nullptr && window_input) {
+		ivec2 size = {};
+		glfwGetFramebufferSize(window, &size.x, &size.y);
+		send_input({ 0, InputEvent::Type::Resize, size.x, size.y });
+	}
+	send_input({ 0, InputEvent::Type::Move, 0, 0, 0, get_cursor_position() });
+}
+
+namespace {
+// FNV-1a over the bytes of a plain value
+template <typename T> void hash_value(uint64_t& hash, const T& value)
+{
+	const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+	for (size_t i = 0; i < sizeof(T); i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3;
+	}
+}
+} // namespace
+
+uint64_t WorldSystem::hash_state() const
+{
+	constexpr uint64_t fnv_offset = 0xcbf29ce484222325;
+	uint64_t hash = fnv_offset;
+	hash_value(hash, tick);
+	hash_value(hash, random->get_seed());
+	hash_value(hash, map_generator->get_current_level());
+	hash_value(hash, turns->get_active_color());
+
+	// Entity ids and storage order depend on everything the registry has held before, not just on this game, so
+	// each entity is hashed on its own and the results are summed, which doesn't care about order
+	uint64_t entities = 0;
+	for (auto [entity, map_pos] : registry.view<MapPosition>().each()) {
+		uint64_t entity_hash = fnv_offset;
+		hash_value(entity_hash, map_pos.position);
+		if (const Stats* stats = registry.try_get<Stats>(entity)) {
+			hash_value(entity_hash, stats->health);
+			hash_value(entity_hash, stats->mana);
+		}
+		if (const Enemy* enemy = registry.try_get<Enemy>(entity)) {
+			hash_value(entity_hash, enemy->type);
+			hash_value(entity_hash, enemy->team);
+			hash_value(entity_hash, enemy->state);
+		}
+		entities += entity_hash;
+	}
+	hash_value(hash, entities);
+	hash_value(hash, registry.get<Inventory>(player).resources);
+	return hash;
+}
+
+bool WorldSystem::perform_action(const PlayerAction& action)
+{
+	if (!awaiting_player()) {
+		return false;
+	}
+	// Player is stunned, whatever they try loses the turn
+	if (combat->get_decrement_effect(player, Effect::Stun) > 0) {
+		end_player_turn();
+		return true;
+	}
+	switch (action.type) {
+	case PlayerAction::Type::Move:
+		return move_player(action.direction);
+	case PlayerAction::Type::Attack: {
+		if (!ui->select_attack(action.attack)) {
+			return false;
+		}
+		Attack& attack = ui->get_current_attack();
+		if (attack.targeting_type == TargetingType::Projectile) {
+			aim_arrow(MapUtility::map_position_to_world_position(action.target));
+			return try_fire_projectile(attack);
+		}
+		return try_adjacent_attack(attack, action.target);
+	}
+	case PlayerAction::Type::SwapColor:
+		return try_change_color();
+	case PlayerAction::Type::UseResource:
+		if (action.resource == Resource::HealthPotion) {
+			return try_drink_potion();
+		}
+		return action.resource == Resource::PaletteSwap && try_change_color();
+	case PlayerAction::Type::Interact:
+		return try_interact();
+	default:
+		return false;
+	}
+}
+
+bool WorldSystem::awaiting_player() const
+{
+	return ui->player_can_act() && !story->in_cutscene() && !is_game_finished() && turns->ready_to_act(player);
+}
+
+// Returns arrow to player after firing
+void WorldSystem::return_arrow_to_player()
+{
+	on_mouse_move(get_cursor_position());
 }
 
 // On key callback
@@ -333,8 +496,7 @@ void WorldSystem::on_key(int key, int /*scancode*/, int action, int mod)
 	}
 	if (turns->ready_to_act(player)) {
 		// Get screen position of mouse
-		dvec2 mouse_screen_pixels_pos = {};
-		glfwGetCursorPos(window, &mouse_screen_pixels_pos.x, &mouse_screen_pixels_pos.y);
+		dvec2 mouse_screen_pixels_pos = get_cursor_position();
 		ui->on_key(key, action, mod, renderer->mouse_pos_to_screen_pos(mouse_screen_pixels_pos));
 	}
 	if (!ui->player_can_act()) {
@@ -387,20 +549,11 @@ void WorldSystem::on_key(int key, int /*scancode*/, int action, int mod)
 			break;
 		}
 		case GLFW_KEY_LEFT_SHIFT: {
-			if (!turns->ready_to_act(player)) break;
-			if (loot->try_pickup_items(player)) {
-				tutorials->destroy_tooltip(TutorialTooltip::ItemDropped);
-				end_player_turn();
-			} else if (map_generator->interact_with_surrounding_tile(player)) {
-				end_player_turn();
-			}
+			try_interact();
 			break;
 		}
 		case GLFW_KEY_H: {
-			if (turns->ready_to_act(player) && combat->try_drink_potion(player)) {
-				ui->update_resource_count();
-				end_player_turn();
-			}
+			try_drink_potion();
 		}
 		default:
 			break;
@@ -457,6 +610,11 @@ bool WorldSystem::check_debug_keys(int key, int action, int mod)
 		debugging.in_debug_mode = action != GLFW_RELEASE;
 	}
 
+	// Toggle the profiler overlay
+	if (action == GLFW_RELEASE && (mod & GLFW_MOD_ALT) != 0 && key == GLFW_KEY_P) {
+		debugging.show_profiler = !debugging.show_profiler;
+	}
+
 	// Control the current volume with `<` `>`
 	if (action != GLFW_RELEASE && (mod & GLFW_MOD_SHIFT) != 0 && key == GLFW_KEY_COMMA) {
 		current_volume -= 0.1f;
@@ -548,39 +706,43 @@ bool WorldSystem::check_debug_keys(int key, int action, int mod)
 // TODO: Integrate into turn state to only enable if player's turn is on
 void WorldSystem::on_mouse_move(vec2 mouse_position)
 {
+	cursor_position = mouse_position;
 	vec2 mouse_screen_pos = renderer->mouse_pos_to_screen_pos(mouse_position);
 	if (ui->player_can_act() && !player_arrow_fired) {
+		aim_arrow(renderer->screen_position_to_world_position(mouse_screen_pos));
+	}
 
-		vec2 mouse_world_pos = renderer->screen_position_to_world_position(mouse_screen_pos);
-
-		Velocity& arrow_velocity = registry.get<Velocity>(player_arrow);
-		WorldPosition& arrow_position = registry.get<WorldPosition>(player_arrow);
-		MapPosition& player_map_position = registry.get<MapPosition>(player);
+	ui->on_mouse_move(mouse_screen_pos);
+}
 
-		vec2 player_screen_position = MapUtility::map_position_to_world_position(player_map_position.position);
+void WorldSystem::aim_arrow(vec2 world_position)
+{
+	Velocity& arrow_velocity = registry.get<Velocity>(player_arrow);
+	WorldPosition& arrow_position = registry.get<WorldPosition>(player_arrow);
+	MapPosition& player_map_position = registry.get<MapPosition>(player);
 
-		// Calculated Euclidean difference between player and arrow
-		vec2 eucl_diff = mouse_world_pos - player_screen_position;
+	vec2 player_screen_position = MapUtility::map_position_to_world_position(player_map_position.position);
 
-		// Calculates arrow position based on position of mouse relative to player
-		vec2 new_arrow_position = normalize(eucl_diff) * spell_distance_from_player + player_screen_position;
-		arrow_position.position = new_arrow_position;
+	// Calculated Euclidean difference between player and arrow
+	vec2 eucl_diff = world_position - player_screen_position;
 
-		// Calculates arrow angle based on position of mouse
-		arrow_velocity.angle = atan2(eucl_diff.x, -eucl_diff.y);
-	}
+	// Calculates arrow position based on position of mouse relative to player
+	vec2 new_arrow_position = normalize(eucl_diff) * spell_distance_from_player + player_screen_position;
+	arrow_position.position = new_arrow_position;
 
-	ui->on_mouse_move(mouse_screen_pos);
+	// Calculates arrow angle based on position of mouse
+	arrow_velocity.angle = atan2(eucl_diff.x, -eucl_diff.y);
 }
 
-void WorldSystem::move_player(Direction direction)
+bool WorldSystem::move_player(Direction direction)
 {
 	if (turns->get_active_team() != player) {
-		return;
+		return false;
 	}
 
 	// Player is immobilized.
-	if (turns->ready_to_act(player) && combat->get_decrement_effect(player, Effect::Immobilize) > 0) {
+	bool immobilized = turns->ready_to_act(player) && combat->get_decrement_effect(player, Effect::Immobilize) > 0;
+	if (immobilized) {
 		end_player_turn();
 	}
 
@@ -605,7 +767,7 @@ void WorldSystem::move_player(Direction direction)
 
 	if (map_pos.position == new_pos || !map_generator->walkable_and_free(player, new_pos)
 		|| !turns->execute_team_action(player)) {
-		return;
+		return immobilized;
 	}
 
 	// Allows player to run if all checks have been passed, inputs running direction as an animation event
@@ -613,11 +775,11 @@ void WorldSystem::move_player(Direction direction)
 
 	MapGeneratorSystem::MoveState move_ret = map_generator->move_player_to_tile(map_pos.position, new_pos);
 	if (move_ret == MapGeneratorSystem::MoveState::Failed) {
-		return;
+		return true;
 	} else if (move_ret == MapGeneratorSystem::MoveState::EndOfGame) {
 		end_player_turn();
 		ui->end_game(true);
-		return;
+		return true;
 	}
 
 	end_player_turn();
@@ -629,6 +791,7 @@ void WorldSystem::move_player(Direction direction)
 		story->load_next_level();
 	}
 	story->check_cutscene();
+	return true;
 }
 
 void WorldSystem::end_player_turn()
@@ -644,18 +807,19 @@ void WorldSystem::end_player_turn()
 	}
 }
 
-void WorldSystem::try_change_color()
+bool WorldSystem::try_change_color()
 {
 	if (!turns->ready_to_act(player)) {
-		return;
+		return false;
 	}
 	Inventory& inventory = registry.get<Inventory>(player);
 	if (inventory.resources.at((size_t)Resource::PaletteSwap) == 0) {
-		return;
+		return false;
 	}
 	MapPosition player_pos = registry.get<MapPosition>(player);
 
-	if (map_generator->walkable_and_free(player, player_pos.position, false)) {
+	bool changed = map_generator->walkable_and_free(player, player_pos.position, false);
+	if (changed) {
 		ColorState inactive_color = turns->get_inactive_color();
 		turns->set_active_color(inactive_color);
 
@@ -670,6 +834,34 @@ void WorldSystem::try_change_color()
 	}
 
 	animations->set_all_inactive_colours(turns->get_inactive_color());
+	return changed;
+}
+
+bool WorldSystem::try_interact()
+{
+	if (!turns->ready_to_act(player)) {
+		return false;
+	}
+	if (loot->try_pickup_items(player)) {
+		tutorials->destroy_tooltip(TutorialTooltip::ItemDropped);
+		end_player_turn();
+		return true;
+	}
+	if (map_generator->interact_with_surrounding_tile(player)) {
+		end_player_turn();
+		return true;
+	}
+	return false;
+}
+
+bool WorldSystem::try_drink_potion()
+{
+	if (!turns->ready_to_act(player) || !combat->try_drink_potion(player)) {
+		return false;
+	}
+	ui->update_resource_count();
+	end_player_turn();
+	return true;
 }
 
 // Fires arrow at a preset speed if it has not been fired already
@@ -678,8 +870,7 @@ void WorldSystem::on_mouse_click(int button, int action, int /*mods*/)
 {
 	if (button == GLFW_MOUSE_BUTTON_LEFT) {
 		// Get screen position of mouse
-		dvec2 mouse_screen_pixels_pos = {};
-		glfwGetCursorPos(window, &mouse_screen_pixels_pos.x, &mouse_screen_pixels_pos.y);
+		dvec2 mouse_screen_pixels_pos = get_cursor_position();
 		bool used = ui->on_left_click(action, renderer->mouse_pos_to_screen_pos(mouse_screen_pixels_pos));
 
 		if (!used && ui->player_can_act() && action == GLFW_PRESS && !story->in_cutscene()) {
@@ -695,7 +886,9 @@ void WorldSystem::on_mouse_click(int button, int action, int /*mods*/)
 			if (attack.targeting_type == TargetingType::Projectile) {
 				try_fire_projectile(attack);
 			} else if (attack.targeting_type == TargetingType::Adjacent) {
-				try_adjacent_attack(attack);
+				vec2 mouse_world_pos = renderer->screen_position_to_world_position(
+					renderer->mouse_pos_to_screen_pos(mouse_screen_pixels_pos));
+				try_adjacent_attack(attack, MapUtility::world_position_to_map_position(mouse_world_pos));
 			}
 		}
 	}
@@ -713,11 +906,11 @@ void WorldSystem::on_mouse_scroll(float offset)
 // TODO: update to scale the scene as not changed when window is resized
 void WorldSystem::on_resize(int width, int height) { renderer->on_resize(width, height); }
 
-void WorldSystem::try_fire_projectile(Attack& attack)
+bool WorldSystem::try_fire_projectile(Attack& attack)
 {
 	if (player_arrow_fired || registry.get<Stats>(player).mana < attack.mana_cost
 		|| !turns->execute_team_action(player)) {
-		return;
+		return false;
 	}
 	tutorials->trigger_tooltip(TutorialTooltip::UseResource);
 	player_arrow_fired = true;
@@ -753,27 +946,20 @@ void WorldSystem::try_fire_projectile(Attack& attack)
 	}
 
 	animations->player_specific_spell(player, ui->get_current_attack().damage_type);
+	return true;
 }
 
-void WorldSystem::try_adjacent_attack(Attack& attack)
+bool WorldSystem::try_adjacent_attack(Attack& attack, uvec2 target)
 {
 	if (!turns->ready_to_act(player)) {
-		return;
+		return false;
 	}
-	// Get position of mouse
-	dvec2 mouse_pos = {};
-	glfwGetCursorPos(window, &mouse_pos.x, &mouse_pos.y);
-
-	// Convert to world pos
-	vec2 mouse_world_pos = renderer->screen_position_to_world_position(renderer->mouse_pos_to_screen_pos(mouse_pos));
-
-	// Get map_positions to compare
-	uvec2 mouse_map_pos = MapUtility::world_position_to_map_position(mouse_world_pos);
-	if (!combat->is_valid_attack(player, attack, mouse_map_pos) || !turns->execute_team_action(player)) {
-		return;
+	if (!combat->is_valid_attack(player, attack, target) || !turns->execute_team_action(player)) {
+		return false;
 	}
-	if (combat->do_attack(player, attack, mouse_map_pos)) {
+	if (combat->do_attack(player, attack, target)) {
 		so_loud->play(light_sword_wav);
 	}
 	end_player_turn();
+	return true;
 }
@@ -17,13 +17,38 @@
 #include "animation_system.hpp"
 #include "combat_system.hpp"
 #include "map_generator_system.hpp"
+#include "input_log.hpp"
 #include "music_system.hpp"
+#include "random_streams.hpp"
 #include "render_system.hpp"
 #include "story_system.hpp"
 #include "turn_system.hpp"
 #include "tutorial_system.hpp"
 #include "ui_system.hpp"
 
+// One turn's worth of player input from a bot, applied through the same rules as keys and clicks but without a
+// window or cursor
+struct PlayerAction {
+	enum class Type : uint8_t {
+		// Steps one tile in direction
+		Move,
+		// Uses the attack numbered as the 1-9 keys number them, aimed at the target tile
+		Attack,
+		// Spends a palette swap to change the active colour
+		SwapColor,
+		// Drinks a health potion or spends a palette swap, other resources are only used by interacting
+		UseResource,
+		// Picks up items or opens doors and chests around the player, as shift does
+		Interact,
+		Count,
+	};
+	Type type = Type::Move;
+	Direction direction = Direction::Undefined;
+	size_t attack = 0;
+	uvec2 target = { 0, 0 };
+	Resource resource = Resource::HealthPotion;
+};
+
 // Container for all our entities and game logic. Individual rendering / update is
 // deferred to the relative update() methods
 class WorldSystem {
@@ -38,7 +63,8 @@ public:
 				std::shared_ptr<TurnSystem> turns,
 				std::shared_ptr<TutorialSystem> tutorials,
 				std::shared_ptr<UISystem> ui,
-				std::shared_ptr<SoLoud::Soloud> so_loud);
+				std::shared_ptr<SoLoud::Soloud> so_loud,
+				std::shared_ptr<RandomStreams> random);
 
 	// Creates a window
 	GLFWwindow* create_window(int width, int height);
@@ -62,7 +88,41 @@ public:
 	// Should the game be over ?
 	bool is_over() const;
 
+	// Has the player died or won, the game waits on the end screen after this
+	bool is_game_finished() const;
+
+	// restart level, reseeding every random stream from the given game seed
+	void restart_game(uint64_t seed);
+	// restart with the seed that follows the current game's
+	void restart_game();
+
+	// Every input, from the window or from a script, comes through here so it can be recorded
+	// The event is stamped with the current tick
+	void send_input(InputEvent event);
+	// Records every input from now on into the log, nullptr stops recording
+	void record_input(InputLog* log);
+	// Replays turn the window's input off, so the only cursor is the recorded one
+	void set_window_input(bool enabled) { window_input = enabled; }
+	// In turbo mode a landed projectile returns on the next step instead of resting where it hit
+	void set_turbo(bool enabled) { turbo = enabled; }
+
+	// Applies a bot's action, returning whether it was taken
+	// Actions are only taken on the player's turn in the game proper, outside the menus and cutscenes
+	bool perform_action(const PlayerAction& action);
+	// True when the game is waiting on the player to act
+	bool awaiting_player() const;
+	bool in_cutscene() const { return story->in_cutscene(); }
+
+	// Ticks stepped since the world was created
+	uint64_t get_tick() const { return tick; }
+
+	// Hash of the simulation state, two runs only match if they played out the same
+	uint64_t hash_state() const;
+
 private:
+	// Input from GLFW's callbacks, dropped while window input is off
+	void on_window_input(const InputEvent& event);
+
 	// Input callback functions
 	void on_key(int key, int /*scancode*/, int action, int mod);
 	void on_mouse_move(vec2 mouse_position);
@@ -70,31 +130,42 @@ private:
 	void on_mouse_scroll(float offset);
 	void on_resize(int width, int height);
 
+	// Where the cursor is in window pixels, the last position passed to on_mouse_move when there is no window
+	dvec2 get_cursor_position() const;
+
 	// Key helpers
 	bool check_debug_keys(int key, int action, int mod);
 
-	// Mouse Click helpers
-	void try_fire_projectile(Attack& attack);
-	void try_adjacent_attack(Attack& attack);
+	// Action helpers, each returns whether the player's turn was used
+	bool try_fire_projectile(Attack& attack);
+	bool try_adjacent_attack(Attack& attack, uvec2 target);
+	bool try_interact();
+	bool try_drink_potion();
 
-	// restart level
-	void restart_game();
+	// Points the arrow from the player towards a world position
+	void aim_arrow(vec2 world_position);
 
 	// returns arrow asset to player
 	void return_arrow_to_player();
 
 	// move the player one unit in the given direction,
 	// if the tile is blocked by a wall, player won't move
-	void move_player(Direction direction);
+	bool move_player(Direction direction);
 
 	// end player turn, downtick relevant bits
 	void end_player_turn();
 
 	// Flips color state.
-	void try_change_color();
+	bool try_change_color();
 
-	// OpenGL window handle
+	// OpenGL window handle, stays null when running headless
 	GLFWwindow* window = nullptr;
+	bool window_input = true;
+	bool turbo = false;
+	dvec2 cursor_position = dvec2(0);
+
+	uint64_t tick = 0;
+	InputLog* input_log = nullptr;
 
 	// Game configuration
 	bool player_arrow_fired = false;
@@ -125,9 +196,8 @@ private:
 	SoLoud::Wav king_mush_summon_wav;
 	SoLoud::Wav king_mush_aoe_wav;
 
-	// C++ random number generator
-	std::shared_ptr<std::default_random_engine> rng;
-	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
+	// Random streams of every system, all derived from the game seed
+	std::shared_ptr<RandomStreams> random;
 
 	std::shared_ptr<AnimationSystem> animations;
 	std::shared_ptr<CombatSystem> combat;
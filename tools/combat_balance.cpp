@@ -0,0 +1,386 @@
+// Estimates how long every attack in data/items takes to kill every enemy in data/enemies, for tuning the numbers
+// Usage: combat_balance [duels per matchup] [threads] [seed] [by attack]
+// Each matchup pits a fresh player holding the item, with its stat boosts, against one enemy in a duel that starts
+// adjacent and is fought to the death on CombatRules, the same dice the game rolls, without a registry or a map.
+// Duels are one dimensional: whoever is out of range walks towards the other, shoves push the target back, and bosses
+// only use their base attack. Duels still going after max_turns count as neither a win nor a loss.
+// Prints CSV with a row per enemy and item tier, or per enemy and attack if by attack is given as 1, with the win and
+// loss rates, the player turns taken to win at the mean and a few percentiles, and the health lost on a win.
+// Matchup i always rolls from the seed and i, so a run repeats exactly whatever the thread count.
+
+// The rest of the game is linked in, so gl3w still needs its definitions even though it is never loaded
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+// json
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+
+// internal
+#include "combat_rules.hpp"
+#include "random_streams.hpp"
+#include "thread_pool.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static constexpr int max_turns = 200;
+
+struct AttackProfile {
+	std::string item;
+	int tier = 0;
+	Attack attack;
+	// The attack's linked list of EffectEntry, copied out of the registry
+	std::vector<EffectEntry> effects;
+	Stats player;
+};
+
+struct EnemyProfile {
+	std::string name;
+	uint danger_rating = 0;
+	Stats stats;
+	int speed = 1;
+	int attack_range = 1;
+	// Bosses are too big to shove
+	bool boss = false;
+};
+
+struct MatchupResult {
+	int wins = 0;
+	int losses = 0;
+	// Duels won after each number of player turns
+	std::array<int, max_turns + 1> win_turns = {};
+	int64_t health_lost_on_wins = 0;
+	int64_t attacks = 0;
+
+	void add(const MatchupResult& other)
+	{
+		wins += other.wins;
+		losses += other.losses;
+		for (size_t i = 0; i < win_turns.size(); i++) {
+			win_turns.at(i) += other.win_turns.at(i);
+		}
+		health_lost_on_wins += other.health_lost_on_wins;
+		attacks += other.attacks;
+	}
+
+	// Smallest number of turns that at least the given fraction of wins took
+	int turns_percentile(double fraction) const
+	{
+		int64_t needed = static_cast<int64_t>(fraction * wins + 0.5);
+		int64_t seen = 0;
+		for (int turns = 0; turns <= max_turns; turns++) {
+			seen += win_turns.at(turns);
+			if (seen >= std::max<int64_t>(needed, 1)) {
+				return turns;
+			}
+		}
+		return max_turns;
+	}
+
+	double turns_mean() const
+	{
+		int64_t total = 0;
+		for (int turns = 0; turns <= max_turns; turns++) {
+			total += static_cast<int64_t>(turns) * win_turns.at(turns);
+		}
+		return (wins == 0) ? 0 : static_cast<double>(total) / wins;
+	}
+};
+
+// One side of a duel, its conditions kept the way ActiveConditions keeps them
+struct Combatant {
+	Stats stats;
+	std::array<int, num_conditions> conditions = {};
+
+	int get(Effect effect) const { return conditions.at((size_t)effect); }
+
+	// Mirrors CombatSystem::get_decrement_effect
+	int decrement(Effect effect)
+	{
+		int& amount = conditions.at((size_t)effect);
+		return (amount == 0) ? 0 : amount--;
+	}
+
+	// Mirrors CombatSystem::apply_decrement_per_turn_effects
+	void end_turn()
+	{
+		for (size_t i = 0; i < num_per_turn_conditions; i++) {
+			auto effect = (Effect)(num_per_use_conditions + i);
+			int amount = decrement(effect);
+			if (amount > 0 && (effect == Effect::Bleed || effect == Effect::Burn)) {
+				stats.health -= CombatRules::condition_damage(effect, amount, stats);
+			}
+		}
+	}
+};
+
+// Mirrors CombatSystem::do_attack and do_attack_effects for a single target
+template <typename Engine>
+static void resolve_attack(Combatant& attacker,
+						   const Attack& attack,
+						   const std::vector<EffectEntry>& effects,
+						   Combatant& target,
+						   bool shoveable,
+						   int& distance,
+						   Engine& rng)
+{
+	attacker.stats.mana -= attack.mana_cost;
+	if (attack.turn_cost > 1) {
+		attacker.conditions.at((size_t)Effect::Stun) = attack.turn_cost - 1;
+	}
+	if (!CombatRules::roll_hit(
+			attack, attacker.stats, attacker.get(Effect::Disarm), target.stats, target.get(Effect::Entangle), rng)) {
+		return;
+	}
+	int damage = CombatRules::roll_damage(attack, attacker.stats, attacker.get(Effect::Weaken), target.stats, rng);
+	target.stats.health -= damage;
+	for (const EffectEntry& effect : effects) {
+		if (!CombatRules::roll_effect(effect.chance, rng)) {
+			continue;
+		}
+		switch (effect.effect) {
+		case Effect::Shove:
+			distance += shoveable ? effect.magnitude : 0;
+			break;
+		case Effect::Crit:
+			target.stats.health -= CombatRules::crit_damage(damage, effect.magnitude);
+			break;
+		default: {
+			int& condition = target.conditions.at((size_t)effect.effect);
+			condition = CombatRules::stack_condition(condition, effect.magnitude);
+			break;
+		}
+		}
+	}
+}
+
+// Projectiles fly until they hit something, adjacent attacks reach their range
+static int reach(const Attack& attack)
+{
+	return (attack.targeting_type == TargetingType::Projectile) ? std::numeric_limits<int>::max() : attack.range;
+}
+
+// Plays one duel with the player moving first, adding its outcome to the result
+template <typename Engine>
+static void duel(const AttackProfile& weapon, const EnemyProfile& enemy, MatchupResult& result, Engine& rng)
+{
+	Combatant player = { weapon.player };
+	Combatant foe = { enemy.stats };
+	int distance = 1;
+	for (int turn = 1; turn <= max_turns; turn++) {
+		// The player loses the turn to a stun, walks in if out of reach, and otherwise attacks if they have the mana
+		if (player.decrement(Effect::Stun) == 0) {
+			if (distance > reach(weapon.attack)) {
+				distance -= (player.decrement(Effect::Immobilize) == 0) ? 1 : 0;
+			} else if (player.stats.mana >= weapon.attack.mana_cost) {
+				resolve_attack(player, weapon.attack, weapon.effects, foe, !enemy.boss, distance, rng);
+				result.attacks++;
+			}
+		}
+		player.end_turn();
+
+		if (foe.stats.health > 0 && player.stats.health > 0) {
+			if (foe.decrement(Effect::Stun) == 0) {
+				if (distance > enemy.attack_range) {
+					if (foe.decrement(Effect::Immobilize) == 0) {
+						distance = std::max(1, distance - enemy.speed);
+					}
+				} else {
+					resolve_attack(foe, enemy.stats.base_attack, {}, player, true, distance, rng);
+					result.attacks++;
+				}
+			}
+			foe.end_turn();
+		}
+
+		if (player.stats.health <= 0) {
+			result.losses++;
+			return;
+		}
+		if (foe.stats.health <= 0) {
+			result.wins++;
+			result.win_turns.at(turn)++;
+			result.health_lost_on_wins += player.stats.health_max - player.stats.health;
+			return;
+		}
+	}
+}
+
+static std::vector<std::filesystem::path> json_files(const std::string& directory)
+{
+	std::vector<std::filesystem::path> paths;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+		if (entry.path().extension() == ".json") {
+			paths.push_back(entry.path());
+		}
+	}
+	// Matchup indices, and so their seeds, shouldn't depend on the order the file system lists things in
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+static void load_json(const std::filesystem::path& path, rapidjson::Document& json)
+{
+	std::ifstream file(path);
+	rapidjson::IStreamWrapper wrapper(file);
+	json.ParseStream(wrapper);
+}
+
+static std::vector<EnemyProfile> load_enemies()
+{
+	std::vector<EnemyProfile> enemies;
+	for (const auto& path : json_files(data_path() + "/enemies/")) {
+		rapidjson::Document json;
+		load_json(path, json);
+		Enemy enemy;
+		enemy.deserialize("", json, false);
+		EnemyProfile& profile = enemies.emplace_back();
+		profile.name = path.stem().string();
+		profile.danger_rating = enemy.danger_rating;
+		profile.stats.deserialize("/stats", json);
+		profile.speed = static_cast<int>(enemy.speed);
+		profile.attack_range = static_cast<int>(enemy.attack_range);
+		profile.boss = enemy.type >= EnemyType::KingMush;
+	}
+	std::stable_sort(enemies.begin(), enemies.end(), [](const EnemyProfile& a, const EnemyProfile& b) {
+		return a.danger_rating < b.danger_rating;
+	});
+	return enemies;
+}
+
+// Loads items through the game's own deserializer, then copies what a duel needs out of the registry
+static std::vector<AttackProfile> load_attacks()
+{
+	std::vector<AttackProfile> attacks;
+	for (const auto& path : json_files(data_path() + "/items/")) {
+		rapidjson::Document json;
+		load_json(path, json);
+		assert(json.IsArray());
+		for (rapidjson::SizeType i = 0; i < json.Size(); i++) {
+			Entity item_entity = registry.create();
+			ItemTemplate& item = registry.emplace<ItemTemplate>(item_entity, "");
+			item.deserialize(item_entity, json[i].GetObj());
+			Weapon* weapon = registry.try_get<Weapon>(item_entity);
+			if (weapon == nullptr) {
+				continue;
+			}
+
+			Stats player;
+			if (const StatBoosts* boosts = registry.try_get<StatBoosts>(item_entity)) {
+				player.health_max += boosts->health;
+				player.health = player.health_max;
+				player.mana_max += boosts->mana;
+				player.mana = player.mana_max;
+				player.to_hit_weapons += boosts->to_hit_weapons;
+				player.to_hit_spells += boosts->to_hit_spells;
+				player.evasion += boosts->evasion;
+				for (size_t type = 0; type < player.damage_bonus.size(); type++) {
+					player.damage_bonus.at(type) += boosts->damage_bonus.at(type);
+					player.damage_modifiers.at(type) += boosts->damage_modifiers.at(type);
+				}
+			}
+
+			for (size_t j = 0; j < weapon->given_attacks.size(); j++) {
+				AttackProfile& profile = attacks.emplace_back();
+				profile.item = item.name;
+				profile.tier = item.tier;
+				profile.attack = weapon->get_attack(j);
+				profile.player = player;
+				for (Entity effect = profile.attack.effects; effect != entt::null;
+					 effect = registry.get<EffectEntry>(effect).next_effect) {
+					profile.effects.push_back(registry.get<EffectEntry>(effect));
+				}
+			}
+		}
+	}
+	std::stable_sort(attacks.begin(), attacks.end(), [](const AttackProfile& a, const AttackProfile& b) {
+		return a.tier < b.tier;
+	});
+	return attacks;
+}
+
+int main(int argc, char* argv[])
+{
+	int duels = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 10000;
+	size_t threads = (argc > 2) ? static_cast<size_t>(std::max(1, std::atoi(argv[2]))) : 0;
+	uint64_t seed = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : RandomStreams::make_seed();
+	bool by_attack = (argc > 4) && std::atoi(argv[4]) != 0;
+
+	std::vector<EnemyProfile> enemies = load_enemies();
+	std::vector<AttackProfile> attacks = load_attacks();
+	if (enemies.empty() || attacks.empty()) {
+		fprintf(stderr, "No enemies or attacks found under %s\n", data_path().c_str());
+		return EXIT_FAILURE;
+	}
+
+	// Every matchup is independent, rolling on its own engine, so the pool can take them in any order
+	ThreadPool pool((threads == 0) ? ThreadPool::hardware_workers : threads - 1);
+	std::vector<MatchupResult> results(enemies.size() * attacks.size());
+	auto start = Clock::now();
+	pool.parallel_for(results.size(), [&](size_t matchup) {
+		std::seed_seq matchup_seed = { static_cast<uint32_t>(seed),
+									   static_cast<uint32_t>(seed >> 32),
+									   static_cast<uint32_t>(matchup) };
+		std::default_random_engine rng(matchup_seed);
+		const EnemyProfile& enemy = enemies.at(matchup / attacks.size());
+		const AttackProfile& attack = attacks.at(matchup % attacks.size());
+		for (int i = 0; i < duels; i++) {
+			duel(attack, enemy, results.at(matchup), rng);
+		}
+	});
+	double seconds = static_cast<double>(
+						 std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count())
+		/ 1e6;
+
+	printf("enemy,danger_rating,tier,%sduels,win_rate,loss_rate,turns_mean,turns_p10,turns_p50,turns_p90,turns_p99,"
+		   "health_lost_mean\n",
+		   by_attack ? "item,attack," : "");
+	int64_t total_attacks = 0;
+	for (size_t e = 0; e < enemies.size(); e++) {
+		const EnemyProfile& enemy = enemies.at(e);
+		for (size_t a = 0; a < attacks.size();) {
+			// Pool every attack of the tier unless each gets its own row
+			MatchupResult pooled;
+			size_t first = a;
+			int rows = 0;
+			for (; a < attacks.size() && attacks.at(a).tier == attacks.at(first).tier && (rows == 0 || !by_attack);
+				 a++, rows++) {
+				pooled.add(results.at(e * attacks.size() + a));
+			}
+			total_attacks += pooled.attacks;
+
+			int total = duels * rows;
+			printf("%s,%u,%d,", enemy.name.c_str(), enemy.danger_rating, attacks.at(first).tier);
+			if (by_attack) {
+				printf("\"%s\",\"%s\",", attacks.at(first).item.c_str(), attacks.at(first).attack.name.c_str());
+			}
+			printf("%d,%.4f,%.4f,%.2f,%d,%d,%d,%d,%.1f\n",
+				   total,
+				   static_cast<double>(pooled.wins) / total,
+				   static_cast<double>(pooled.losses) / total,
+				   pooled.turns_mean(),
+				   pooled.turns_percentile(0.1),
+				   pooled.turns_percentile(0.5),
+				   pooled.turns_percentile(0.9),
+				   pooled.turns_percentile(0.99),
+				   (pooled.wins == 0) ? 0 : static_cast<double>(pooled.health_lost_on_wins) / pooled.wins);
+		}
+	}
+	fprintf(stderr,
+			"%zu matchups of %d duels from seed %llu on %zu threads in %.2f s, %.0f attacks/s\n",
+			results.size(),
+			duels,
+			static_cast<unsigned long long>(seed),
+			pool.size(),
+			seconds,
+			static_cast<double>(total_attacks) / seconds);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+// Plays games back to back without a window, GL context or audio device, for batch runs on CI and servers
+// Usage: headless_simulation [games] [max ticks per game] [input script or -] [threads] [first seed] [turbo]
+// Each thread runs its own game, taking the next one as soon as it finishes
+// A game ends when the player dies or wins, or after the maximum number of ticks
+// The script is replayed from the start of every game, one event per line:
+//   <tick> key <key> <action> <mods>
+//   <tick> click <button> <action> <mods>
+//   <tick> move <x> <y>
+//   <tick> scroll <offset>
+// using GLFW's key, button and action codes and window pixel positions, lines starting with # are ignored
+// Without a script the player wanders, pressing a random movement key every few ticks
+// Game i plays from the first seed plus i, with a random first seed unless one is given
+// Games run in turbo mode, one turn per tick, unless turbo is given as 0
+
+// The rest of the game is linked in, so gl3w still needs its definitions even though it is never loaded
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+// internal
+#include "headless_game.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static constexpr size_t wander_interval_ticks = 10;
+static constexpr std::array<int, 4> wander_keys = { GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D };
+
+static bool load_script(const char* path, std::vector<InputEvent>& script)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		fprintf(stderr, "Could not open input script %s\n", path);
+		return false;
+	}
+	std::string line;
+	for (size_t line_number = 1; std::getline(file, line); line_number++) {
+		if (line.empty() || line.front() == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		InputEvent input;
+		std::string type;
+		fields >> input.tick >> type;
+		if (type == "key" || type == "click") {
+			input.type = (type == "key") ? InputEvent::Type::Key : InputEvent::Type::Click;
+			fields >> input.code >> input.action >> input.mods;
+		} else if (type == "move") {
+			input.type = InputEvent::Type::Move;
+			fields >> input.position.x >> input.position.y;
+		} else if (type == "scroll") {
+			input.type = InputEvent::Type::Scroll;
+			fields >> input.position.y;
+		} else {
+			fields.setstate(std::ios::failbit);
+		}
+		if (fields.fail()) {
+			fprintf(stderr, "%s:%zu: could not read \"%s\"\n", path, line_number, line.c_str());
+			return false;
+		}
+		script.push_back(input);
+	}
+	std::stable_sort(script.begin(), script.end(), [](const InputEvent& a, const InputEvent& b) {
+		return a.tick < b.tick;
+	});
+	return true;
+}
+
+struct BatchResult {
+	size_t ticks = 0;
+	int finished = 0;
+};
+
+// Plays games until the shared counter runs out, creating, ticking and destroying its game on the calling thread
+// Game i always plays from seed first_seed + i, whichever thread picks it up, so any one of them can be rerun alone
+static BatchResult play_games(std::atomic<int>& next_game,
+							  int games,
+							  uint64_t first_seed,
+							  size_t max_ticks,
+							  const std::vector<InputEvent>& script,
+							  size_t lighting_workers,
+							  bool turbo)
+{
+	BatchResult result;
+	std::unique_ptr<HeadlessGame> game;
+	std::default_random_engine wander_rng;
+	std::uniform_int_distribution<size_t> wander_dist(0, wander_keys.size() - 1);
+
+	for (int index = next_game++; index < games; index = next_game++) {
+		uint64_t seed = first_seed + static_cast<uint64_t>(index);
+		if (game == nullptr) {
+			game = std::make_unique<HeadlessGame>(seed, lighting_workers);
+		} else {
+			game->restart(seed);
+		}
+		game->set_turbo(turbo);
+		wander_rng.seed(static_cast<unsigned int>(seed));
+		WorldSystem& world = game->get_world();
+
+		size_t next_input = 0;
+		while (game->get_tick() < max_ticks && !world.is_game_finished()) {
+			if (script.empty()) {
+				if (game->get_tick() % wander_interval_ticks == 0) {
+					int key = wander_keys.at(wander_dist(wander_rng));
+					world.send_input({ 0, InputEvent::Type::Key, key, GLFW_PRESS });
+					world.send_input({ 0, InputEvent::Type::Key, key, GLFW_RELEASE });
+				}
+			} else {
+				for (; next_input < script.size() && script.at(next_input).tick <= game->get_tick(); next_input++) {
+					world.send_input(script.at(next_input));
+				}
+			}
+			game->tick();
+		}
+		result.ticks += game->get_tick();
+		result.finished += world.is_game_finished() ? 1 : 0;
+	}
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	int games = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 10;
+	size_t max_ticks = (argc > 2) ? static_cast<size_t>(std::max(1, std::atoi(argv[2]))) : 60 * 60 * 10;
+	std::vector<InputEvent> script;
+	if (argc > 3 && std::string(argv[3]) != "-" && !load_script(argv[3], script)) {
+		return EXIT_FAILURE;
+	}
+	unsigned int hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+	unsigned int threads = (argc > 4) ? static_cast<unsigned int>(std::max(1, std::atoi(argv[4]))) : 1;
+	threads = std::min(threads, static_cast<unsigned int>(games));
+	uint64_t first_seed = (argc > 5) ? std::strtoull(argv[5], nullptr, 10) : RandomStreams::make_seed();
+	bool turbo = (argc > 6) ? std::atoi(argv[6]) != 0 : true;
+
+	// A lone game gets the lighting pool to itself, otherwise the games already keep every core busy
+	size_t lighting_workers = (threads == 1) ? ThreadPool::hardware_workers : 0;
+	std::atomic<int> next_game(0);
+	std::vector<BatchResult> results(threads);
+
+	auto start = Clock::now();
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++) {
+		workers.emplace_back([&, i]() {
+			results.at(i) = play_games(next_game, games, first_seed, max_ticks, script, lighting_workers, turbo);
+		});
+	}
+	results.front() = play_games(next_game, games, first_seed, max_ticks, script, lighting_workers, turbo);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	double seconds = static_cast<double>(
+						 std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count())
+		/ 1e6;
+
+	size_t total_ticks = 0;
+	int finished = 0;
+	for (const BatchResult& result : results) {
+		total_ticks += result.ticks;
+		finished += result.finished;
+	}
+	printf("%d games from seed %llu on %u of %u threads%s, %d finished, %zu ticks in %.2f s\n",
+		   games,
+		   static_cast<unsigned long long>(first_seed),
+		   threads,
+		   hardware_threads,
+		   turbo ? " in turbo mode" : "",
+		   finished,
+		   total_ticks,
+		   seconds);
+	printf("%.0f ticks/s, %.0f games/hour, %.1fx real time\n",
+		   static_cast<double>(total_ticks) / seconds,
+		   games * 3600 / seconds,
+		   static_cast<double>(total_ticks) * tick_ms / 1000 / seconds);
+	return EXIT_SUCCESS;
+}
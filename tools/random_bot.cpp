@@ -0,0 +1,115 @@
+// Plays batches of games with a random bot through VectorEnvironment, to measure how fast bots can be trained
+// Usage: random_bot [environments] [steps] [first seed]
+// Each environment runs on a thread of its own
+// The bot hits the nearest enemy of the active colour when one is next to it, otherwise it mostly wanders
+// Environment i starts from the first seed plus i, and finished games restart from the next unused seed
+
+// The rest of the game is linked in, so gl3w still needs its definitions even though it is never loaded
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// internal
+#include "vector_environment.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+static constexpr std::array<Direction, 4> directions
+	= { Direction::Left, Direction::Up, Direction::Right, Direction::Down };
+
+static PlayerAction choose_action(const BotObservation& observation, std::default_random_engine& rng)
+{
+	for (size_t i = 0; i < observation.entity_count; i++) {
+		const BotObservation::VisibleEntity& entity = observation.entities.at(i);
+		bool adjacent = std::max(abs(entity.offset.x), abs(entity.offset.y)) == 1;
+		if (entity.kind == BotObservation::VisibleEntity::Kind::Enemy && entity.team == observation.active_color
+			&& adjacent && observation.attack_count > 0) {
+			PlayerAction attack = { PlayerAction::Type::Attack };
+			attack.target = uvec2(ivec2(observation.position) + entity.offset);
+			return attack;
+		}
+	}
+	std::uniform_int_distribution<int> roll(0, 19);
+	int choice = roll(rng);
+	if (choice == 0) {
+		return { PlayerAction::Type::Interact };
+	}
+	if (choice == 1 && observation.health * 2 < observation.health_max) {
+		return { PlayerAction::Type::UseResource, Direction::Undefined, 0, { 0, 0 }, Resource::HealthPotion };
+	}
+	return { PlayerAction::Type::Move, directions.at(static_cast<size_t>(choice) % directions.size()) };
+}
+
+int main(int argc, char* argv[])
+{
+	size_t count = (argc > 1) ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 8;
+	size_t steps = (argc > 2) ? static_cast<size_t>(std::max(1, std::atoi(argv[2]))) : 1000;
+	uint64_t first_seed = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : RandomStreams::make_seed();
+
+	VectorEnvironment environments(count);
+	std::vector<uint64_t> seeds(count);
+	for (size_t i = 0; i < count; i++) {
+		seeds.at(i) = first_seed + i;
+	}
+	uint64_t next_seed = first_seed + count;
+
+	std::vector<std::default_random_engine> rngs;
+	for (uint64_t seed : seeds) {
+		rngs.emplace_back(static_cast<unsigned int>(seed));
+	}
+	std::vector<BotObservation> observations = environments.reset(seeds);
+	std::vector<PlayerAction> actions(count);
+	std::vector<bool> finished_mask(count);
+
+	size_t total_ticks = 0;
+	size_t rejected = 0;
+	int finished = 0;
+	int won = 0;
+	auto start = Clock::now();
+	for (size_t step = 0; step < steps; step++) {
+		for (size_t i = 0; i < count; i++) {
+			actions.at(i) = choose_action(observations.at(i), rngs.at(i));
+		}
+		std::vector<BotStepResult> results = environments.step(actions);
+
+		bool any_done = false;
+		std::fill(finished_mask.begin(), finished_mask.end(), false);
+		for (size_t i = 0; i < count; i++) {
+			const BotStepResult& result = results.at(i);
+			total_ticks += result.ticks;
+			rejected += result.action_rejected ? 1 : 0;
+			observations.at(i) = result.observation;
+			if (result.done || result.truncated) {
+				finished++;
+				won += (result.reward > 0) ? 1 : 0;
+				seeds.at(i) = next_seed++;
+				finished_mask.at(i) = true;
+				any_done = true;
+			}
+		}
+		if (any_done) {
+			observations = environments.reset(seeds, finished_mask);
+		}
+	}
+	double seconds = static_cast<double>(
+						 std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count())
+		/ 1e6;
+
+	printf("%zu environments from seed %llu, %zu steps each in %.2f s\n",
+		   count,
+		   static_cast<unsigned long long>(first_seed),
+		   steps,
+		   seconds);
+	printf("%.0f steps/s, %.1f ticks/step, %.0f%% of actions rejected, %d games finished, %d won\n",
+		   static_cast<double>(steps * count) / seconds,
+		   static_cast<double>(total_ticks) / static_cast<double>(steps * count),
+		   100.0 * static_cast<double>(rejected) / static_cast<double>(steps * count),
+		   finished,
+		   won);
+	return EXIT_SUCCESS;
+}
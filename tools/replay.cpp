@@ -0,0 +1,95 @@
+// Plays a recorded session back headless as fast as it will go, to turn real play into a repeatable benchmark
+// Usage: replay <input log> [runs] [expected state hash]
+// Record a session with the game's --record option. Every run replays the whole log on a fresh thread, and so a fresh
+// registry, then reports the time spent in each system and a hash of the final state, plus the profiler's percentiles
+// in builds with ENABLE_PROFILER.
+// Exits with a failure if the runs disagree, or if a given hash doesn't match, so optimizations that change how a
+// game plays out are caught.
+
+// The rest of the game is linked in, so gl3w still needs its definitions even though it is never loaded
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// internal
+#include "headless_game.hpp"
+#include "input_log.hpp"
+#include "profiler.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Replays the whole log into a new game, which has to live on the calling thread
+static uint64_t replay(const InputLog& log)
+{
+	// The recording starts at the main menu and clicks its way in
+	HeadlessGame game(log.get_seed(), ThreadPool::hardware_workers, false);
+	WorldSystem& world = game.get_world();
+	const std::vector<InputEvent>& inputs = log.get_events();
+
+	size_t next_input = 0;
+	auto start = Clock::now();
+	while (world.get_tick() < log.get_end_tick()) {
+		for (; next_input < inputs.size() && inputs.at(next_input).tick <= world.get_tick(); next_input++) {
+			world.send_input(inputs.at(next_input));
+		}
+		game.tick();
+	}
+	double seconds = static_cast<double>(
+						 std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count())
+		/ 1e6;
+
+	uint64_t hash = world.hash_state();
+	printf("%llu ticks in %.3f s, %.0f ticks/s, state hash %016llx\n",
+		   static_cast<unsigned long long>(world.get_tick()),
+		   seconds,
+		   static_cast<double>(world.get_tick()) / seconds,
+		   static_cast<unsigned long long>(hash));
+	game.get_timings().print(world.get_tick());
+#ifdef ENABLE_PROFILER
+	// The run's own thread, so its profiler only holds this run's scopes
+	printf("%s\n", Profiler::current().summary().c_str());
+#endif
+	return hash;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <input log> [runs] [expected state hash]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	InputLog log;
+	if (!log.load(argv[1])) {
+		return EXIT_FAILURE;
+	}
+	int runs = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 1;
+	printf("%zu inputs over %llu ticks from seed %llu\n",
+		   log.get_events().size(),
+		   static_cast<unsigned long long>(log.get_end_tick()),
+		   static_cast<unsigned long long>(log.get_seed()));
+
+	std::vector<uint64_t> hashes;
+	for (int run = 0; run < runs; run++) {
+		std::thread worker([&]() { hashes.push_back(replay(log)); });
+		worker.join();
+	}
+
+	bool diverged = std::any_of(hashes.begin(), hashes.end(), [&](uint64_t hash) { return hash != hashes.front(); });
+	if (diverged) {
+		fprintf(stderr, "Runs of the same log ended in different states\n");
+		return EXIT_FAILURE;
+	}
+	if (argc > 3 && std::strtoull(argv[3], nullptr, 16) != hashes.front()) {
+		fprintf(stderr, "State hash %016llx doesn't match the expected %s\n",
+				static_cast<unsigned long long>(hashes.front()),
+				argv[3]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}